@@ -0,0 +1,251 @@
+#define _GNU_SOURCE /* copy_file_range */
+#include "file_tree.h"
+#include "stats.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <linux/fs.h>
+
+#define COPY_CHUNK (1024 * 1024)
+#define POOL_MAX_THREADS 4
+
+/* ------------------------- copying ------------------------ */
+/* errno values meaning "this path is not available here, try the next" */
+static gboolean unsupported(int err) {
+    return err == ENOSYS || err == EINVAL || err == EXDEV || err == EOPNOTSUPP || err == ENOTSUP;
+}
+
+static gboolean check_cancelled(GCancellable *cancellable) {
+    if (!g_cancellable_is_cancelled(cancellable)) return FALSE;
+    errno = ECANCELED;
+    return TRUE;
+}
+
+static gboolean copy_read_write(int in, int out, GCancellable *cancellable) {
+    char *buf = g_malloc(COPY_CHUNK);
+    gboolean ok = TRUE;
+    while (ok) {
+        if (check_cancelled(cancellable)) {
+            ok = FALSE;
+            break;
+        }
+        ssize_t n = read(in, buf, COPY_CHUNK);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        for (ssize_t off = 0; off < n;) {
+            ssize_t w = write(out, buf + off, n - off);
+            if (w < 0 && errno == EINTR) continue;
+            if (w < 0) {
+                ok = FALSE;
+                break;
+            }
+            off += w;
+        }
+    }
+    g_free(buf);
+    return ok;
+}
+
+gboolean file_tree_copy_fd(int in, int out, GCancellable *cancellable) {
+#ifdef FICLONE
+    if (ioctl(out, FICLONE, in) == 0) return TRUE;
+#endif
+
+    /* In-kernel copies; either may be refused before the first byte moves */
+    gboolean copied = FALSE;
+    for (;;) {
+        if (check_cancelled(cancellable)) return FALSE;
+        ssize_t n = copy_file_range(in, NULL, out, NULL, COPY_CHUNK, 0);
+        if (n > 0) {
+            copied = TRUE;
+            continue;
+        }
+        if (n == 0) return TRUE;
+        if (errno == EINTR) continue;
+        if (copied || !unsupported(errno)) return FALSE;
+        break;
+    }
+
+    for (;;) {
+        if (check_cancelled(cancellable)) return FALSE;
+        ssize_t n = sendfile(out, in, NULL, COPY_CHUNK);
+        if (n > 0) {
+            copied = TRUE;
+            continue;
+        }
+        if (n == 0) return TRUE;
+        if (errno == EINTR) continue;
+        if (copied || !unsupported(errno)) return FALSE;
+        break;
+    }
+
+    return copy_read_write(in, out, cancellable);
+}
+
+/* ------------------------- walking ------------------------ */
+static gboolean is_dot_or_dotdot(const char *name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+static gboolean entry_is_dir(DIR *dir, const struct dirent *de) {
+    if (de->d_type != DT_UNKNOWN) return de->d_type == DT_DIR;
+    struct stat st;
+    return fstatat(dirfd(dir), de->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+}
+
+static int open_dir_at(int parent_fd, const char *name) {
+    return openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+}
+
+/* Takes ownership of dir_fd */
+static gint count_at(int dir_fd, GCancellable *cancellable) {
+    DIR *dir = fdopendir(dir_fd);
+    if (!dir) {
+        close(dir_fd);
+        return 0;
+    }
+
+    gint n = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) && !g_cancellable_is_cancelled(cancellable)) {
+        if (is_dot_or_dotdot(de->d_name)) continue;
+        if (!entry_is_dir(dir, de)) {
+            n++;
+            continue;
+        }
+        int child = open_dir_at(dirfd(dir), de->d_name);
+        if (child >= 0) n += count_at(child, cancellable);
+    }
+    closedir(dir);
+    return n;
+}
+
+gint file_tree_count(const char *path, GCancellable *cancellable) {
+    int fd = open_dir_at(AT_FDCWD, path);
+    return fd < 0 ? 0 : count_at(fd, cancellable);
+}
+
+/* Empties the directory dir_fd refers to; takes ownership of dir_fd */
+static gboolean remove_children_at(int dir_fd, gint *progress, GCancellable *cancellable) {
+    DIR *dir = fdopendir(dir_fd);
+    if (!dir) {
+        close(dir_fd);
+        return FALSE;
+    }
+
+    gboolean ok = TRUE;
+    struct dirent *de;
+    while ((de = readdir(dir))) {
+        if (is_dot_or_dotdot(de->d_name)) continue;
+        if (g_cancellable_is_cancelled(cancellable)) {
+            ok = FALSE;
+            break;
+        }
+
+        if (entry_is_dir(dir, de)) {
+            int child = open_dir_at(dirfd(dir), de->d_name);
+            if (child < 0 || !remove_children_at(child, progress, cancellable)
+                || unlinkat(dirfd(dir), de->d_name, AT_REMOVEDIR) != 0)
+                ok = FALSE;
+        } else if (unlinkat(dirfd(dir), de->d_name, 0) == 0) {
+            if (progress) g_atomic_int_inc(progress);
+        } else {
+            ok = FALSE;
+        }
+    }
+    closedir(dir);
+    return ok;
+}
+
+gboolean file_tree_remove(const char *path, gint *progress, GCancellable *cancellable) {
+    if (unlink(path) == 0) {
+        if (progress) g_atomic_int_inc(progress);
+        return TRUE;
+    }
+    if (errno == ENOENT) return TRUE;
+
+    int fd = open_dir_at(AT_FDCWD, path);
+    if (fd < 0) return FALSE;
+    gint64 span = stats_begin();
+    gboolean ok = remove_children_at(fd, progress, cancellable) && rmdir(path) == 0;
+    stats_end(STATS_TREE_REMOVE, span);
+    return ok;
+}
+
+/* ------------------------- worker pool ------------------------ */
+struct _FileTreePool {
+    GThreadPool *threads; /* NULL if no thread could be started: run inline */
+    FileTreeTask task;
+    gpointer user_data;
+    gint *progress;
+    GCancellable *cancellable;
+
+    GMutex lock;
+    guint failures;
+    GError *first_error;
+};
+
+static void pool_run(gpointer item, gpointer data) {
+    FileTreePool *pool = data;
+    GError *error = NULL;
+
+    if (!g_cancellable_is_cancelled(pool->cancellable)
+        && !pool->task(item, pool->user_data, pool->cancellable, &error)) {
+        if (!error) error = g_error_new_literal(G_IO_ERROR, G_IO_ERROR_FAILED, "Unknown error");
+        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            g_printerr("%s\n", error->message);
+
+        g_mutex_lock(&pool->lock);
+        pool->failures++;
+        if (!pool->first_error) pool->first_error = error;
+        else g_error_free(error);
+        g_mutex_unlock(&pool->lock);
+    }
+
+    if (pool->progress) g_atomic_int_inc(pool->progress);
+}
+
+FileTreePool *file_tree_pool_new(FileTreeTask task, gpointer user_data, gint *progress,
+                                 GCancellable *cancellable) {
+    FileTreePool *pool = g_new0(FileTreePool, 1);
+    pool->task = task;
+    pool->user_data = user_data;
+    pool->progress = progress;
+    pool->cancellable = cancellable;
+    g_mutex_init(&pool->lock);
+
+    /* Small files dominate presets, so a few threads are enough to keep
+     * the disk busy; more just contend on the directory locks */
+    gint threads = CLAMP((gint)g_get_num_processors(), 1, POOL_MAX_THREADS);
+    pool->threads = g_thread_pool_new(pool_run, pool, threads, FALSE, NULL);
+    return pool;
+}
+
+void file_tree_pool_push(FileTreePool *pool, gpointer item) {
+    if (!pool->threads || !g_thread_pool_push(pool->threads, item, NULL)) pool_run(item, pool);
+}
+
+guint file_tree_pool_finish(FileTreePool *pool, GError **error) {
+    if (pool->threads) g_thread_pool_free(pool->threads, FALSE, TRUE);
+
+    guint failures = pool->failures;
+    if (g_cancellable_set_error_if_cancelled(pool->cancellable, error)) {
+        g_clear_error(&pool->first_error);
+    } else if (pool->first_error) {
+        if (failures > 1)
+            g_prefix_error(&pool->first_error, "%u files failed, the first: ", failures);
+        g_propagate_error(error, pool->first_error);
+    }
+
+    g_mutex_clear(&pool->lock);
+    g_free(pool);
+    return failures;
+}
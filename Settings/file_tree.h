@@ -0,0 +1,36 @@
+#ifndef FILE_TREE_H
+#define FILE_TREE_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+/* Directory-tree helpers for the Waybar preset code. None of them follow
+ * symlinks, and all of them read entry types from dirent d_type, only
+ * falling back to a stat when the filesystem does not report one.
+ * progress, when non-NULL, is atomically incremented once per file. */
+
+/* Copy the contents of in to out, both at offset 0: reflink (FICLONE) when
+ * the filesystem shares extents, else copy_file_range, sendfile and finally
+ * read/write. Sets errno and returns FALSE on failure. */
+gboolean file_tree_copy_fd(int in, int out, GCancellable *cancellable);
+
+/* Non-directory entries below path */
+gint file_tree_count(const char *path, GCancellable *cancellable);
+
+/* rm -rf; TRUE if path is gone afterwards */
+gboolean file_tree_remove(const char *path, gint *progress, GCancellable *cancellable);
+
+/* A small pool of threads running one task per file. Every failure is
+ * printed as it happens; finish() waits for all tasks and reports how many
+ * failed along with the first error. */
+typedef gboolean (*FileTreeTask)(gpointer item, gpointer user_data,
+                                 GCancellable *cancellable, GError **error);
+
+typedef struct _FileTreePool FileTreePool;
+
+FileTreePool *file_tree_pool_new(FileTreeTask task, gpointer user_data, gint *progress,
+                                 GCancellable *cancellable);
+void file_tree_pool_push(FileTreePool *pool, gpointer item);
+guint file_tree_pool_finish(FileTreePool *pool, GError **error);
+
+#endif // FILE_TREE_H
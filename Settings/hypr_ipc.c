@@ -0,0 +1,132 @@
+#include "hypr_ipc.h"
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+#include <string.h>
+
+#define IPC_TIMEOUT_S 2
+#define BATCH_PREFIX "[[BATCH]]"
+/* Hyprland reads requests into a fixed buffer; stay well under it */
+#define MAX_REQUEST 8000
+
+/* ------------------------- socket transport ------------------------ */
+char *hypr_ipc_socket_path(void) {
+    const char *signature = g_getenv("HYPRLAND_INSTANCE_SIGNATURE");
+    if (!signature || !*signature) return NULL;
+    return g_build_filename(g_get_user_runtime_dir(), "hypr", signature, ".socket.sock", NULL);
+}
+
+static char *socket_request(gpointer data, const char *request, GError **error) {
+    char *path = hypr_ipc_socket_path();
+    if (!path) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "not running under Hyprland");
+        return NULL;
+    }
+
+    GSocketClient *client = g_socket_client_new();
+    g_socket_client_set_timeout(client, IPC_TIMEOUT_S);
+    GSocketAddress *address = g_unix_socket_address_new(path);
+    GSocketConnection *conn = g_socket_client_connect(client, G_SOCKET_CONNECTABLE(address), NULL, error);
+    g_object_unref(address);
+    g_object_unref(client);
+    g_free(path);
+    if (!conn) return NULL;
+
+    GString *reply = NULL;
+    GOutputStream *out = g_io_stream_get_output_stream(G_IO_STREAM(conn));
+    if (g_output_stream_write_all(out, request, strlen(request), NULL, NULL, error)) {
+        GInputStream *in = g_io_stream_get_input_stream(G_IO_STREAM(conn));
+        reply = g_string_new(NULL);
+        char buf[4096];
+        gssize n;
+        while ((n = g_input_stream_read(in, buf, sizeof(buf), NULL, error)) > 0)
+            g_string_append_len(reply, buf, n);
+        if (n < 0) {
+            g_string_free(reply, TRUE);
+            reply = NULL;
+        }
+    }
+
+    g_io_stream_close(G_IO_STREAM(conn), NULL, NULL);
+    g_object_unref(conn);
+    return reply ? g_string_free(reply, FALSE) : NULL;
+}
+
+static const HyprIpcTransport socket_transport = { socket_request, NULL };
+static const HyprIpcTransport *g_transport = &socket_transport;
+
+void hypr_ipc_set_transport(const HyprIpcTransport *transport) {
+    g_transport = transport ? transport : &socket_transport;
+}
+
+gboolean hypr_ipc_available(void) {
+    if (g_transport != &socket_transport) return TRUE;
+    char *path = hypr_ipc_socket_path();
+    gboolean exists = path && g_file_test(path, G_FILE_TEST_EXISTS);
+    g_free(path);
+    return exists;
+}
+
+char *hypr_ipc_request(const char *request, GError **error) {
+    return g_transport->request(g_transport->data, request, error);
+}
+
+/* ------------------------- batches ------------------------ */
+/* A batch reply is one reply per command, separated by blank lines */
+static gboolean check_replies(const char *reply, GPtrArray *commands, guint first, GError **error) {
+    char **parts = g_strsplit(reply, "\n\n", -1);
+    guint i = 0;
+    gboolean ok = TRUE;
+    for (char **p = parts; *p && ok; p++) {
+        g_strstrip(*p);
+        if (**p == '\0') continue;
+        if (strcmp(*p, "ok") != 0) {
+            const char *command = first + i < commands->len ? g_ptr_array_index(commands, first + i) : "?";
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "\"%s\": %s", command, *p);
+            ok = FALSE;
+        }
+        i++;
+    }
+    g_strfreev(parts);
+    return ok;
+}
+
+static gboolean send_batch(GString *request, GPtrArray *commands, guint first, GError **error) {
+    char *reply = hypr_ipc_request(request->str, error);
+    if (!reply) return FALSE;
+    gboolean ok = check_replies(reply, commands, first, error);
+    g_free(reply);
+    return ok;
+}
+
+gboolean hypr_ipc_run(GPtrArray *commands, GError **error) {
+    GString *request = g_string_new(NULL);
+    guint first = 0;
+    gboolean ok = TRUE;
+
+    for (guint i = 0; i < commands->len && ok; i++) {
+        const char *command = g_ptr_array_index(commands, i);
+        /* ';' separates batched commands, so such a command goes alone */
+        gboolean alone = strchr(command, ';') != NULL;
+        gboolean full = request->len > 0 && request->len + 1 + strlen(command) > MAX_REQUEST;
+        if (request->len > 0 && (alone || full)) {
+            ok = send_batch(request, commands, first, error);
+            g_string_truncate(request, 0);
+            first = i;
+        }
+        if (!ok) break;
+
+        if (alone) {
+            g_string_assign(request, command);
+            ok = send_batch(request, commands, i, error);
+            g_string_truncate(request, 0);
+            first = i + 1;
+            continue;
+        }
+        g_string_append(request, request->len == 0 ? BATCH_PREFIX : ";");
+        g_string_append(request, command);
+    }
+    if (ok && request->len > 0) ok = send_batch(request, commands, first, error);
+
+    g_string_free(request, TRUE);
+    return ok;
+}
@@ -0,0 +1,35 @@
+#ifndef HYPR_IPC_H
+#define HYPR_IPC_H
+
+#include <glib.h>
+
+/* Hyprland's request socket,
+ * $XDG_RUNTIME_DIR/hypr/$HYPRLAND_INSTANCE_SIGNATURE/.socket.sock: one
+ * request per connection, the reply is everything read until EOF. */
+
+/* How requests reach the compositor. The default connects to the socket
+ * above; a test can install its own, or point the environment at a mock
+ * server's socket. */
+typedef struct {
+    char *(*request)(gpointer data, const char *request, GError **error);
+    gpointer data;
+} HyprIpcTransport;
+
+/* NULL restores the socket transport */
+void hypr_ipc_set_transport(const HyprIpcTransport *transport);
+
+/* Path of the request socket, NULL when not running under Hyprland */
+char *hypr_ipc_socket_path(void);
+
+/* Whether requests can be sent at all (a socket or a custom transport) */
+gboolean hypr_ipc_available(void);
+
+/* One raw request ("keyword ...", "reload", "[[BATCH]]..."), newly
+ * allocated reply */
+char *hypr_ipc_request(const char *request, GError **error);
+
+/* Runs commands in order, as few [[BATCH]] requests as possible. Fails on
+ * the first reply other than "ok", naming the command. */
+gboolean hypr_ipc_run(GPtrArray *commands, GError **error);
+
+#endif // HYPR_IPC_H
@@ -0,0 +1,168 @@
+#include "keybind.h"
+#include <string.h>
+
+/* ------------------------- variables ------------------------ */
+static GHashTable *g_variables = NULL; /* name without '$' -> value */
+
+void keybind_set_variable(const char *name, gsize name_len, const char *value, gsize value_len) {
+    if (!g_variables)
+        g_variables = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    g_hash_table_replace(g_variables, g_strndup(name, name_len), g_strndup(value, value_len));
+}
+
+void keybind_clear_variables(void) {
+    if (g_variables) g_hash_table_remove_all(g_variables);
+}
+
+void keybind_foreach_variable(GHFunc func, gpointer user_data) {
+    if (g_variables) g_hash_table_foreach(g_variables, func, user_data);
+}
+
+static const char *lookup_variable(const char *name, gsize len) {
+    char buf[64];
+    if (!g_variables || len >= sizeof(buf)) return NULL;
+    memcpy(buf, name, len);
+    buf[len] = '\0';
+    return g_hash_table_lookup(g_variables, buf);
+}
+
+/* ------------------------- field helpers ------------------------ */
+static void span_trim(const char **start, const char **end) {
+    while (*start < *end && (**start == ' ' || **start == '\t')) (*start)++;
+    while (*end > *start && ((*end)[-1] == ' ' || (*end)[-1] == '\t')) (*end)--;
+}
+
+static gboolean is_ident_char(char c) {
+    return g_ascii_isalnum(c) || c == '_';
+}
+
+/* Letters after "bind"; any unknown letter means this is not a bind line */
+static guint16 parse_flags(const char *s, const char *e) {
+    guint16 flags = KB_FLAG_BIND;
+    for (; s < e; s++) {
+        switch (*s) {
+        case 'l': flags |= KB_FLAG_LOCKED; break;
+        case 'r': flags |= KB_FLAG_RELEASE; break;
+        case 'e': flags |= KB_FLAG_REPEAT; break;
+        case 'n': flags |= KB_FLAG_NONCONSUMING; break;
+        case 'm': flags |= KB_FLAG_MOUSE; break;
+        case 't': flags |= KB_FLAG_TRANSPARENT; break;
+        case 'i': flags |= KB_FLAG_IGNORE_MODS; break;
+        case 's': flags |= KB_FLAG_SEPARATE; break;
+        case 'd': flags |= KB_FLAG_DESCRIPTION; break;
+        case 'p': flags |= KB_FLAG_BYPASS; break;
+        case 'o': flags |= KB_FLAG_LONG_PRESS; break;
+        case 'c': flags |= KB_FLAG_CLICK; break;
+        case 'g': flags |= KB_FLAG_DRAG; break;
+        default: return 0;
+        }
+    }
+    return flags;
+}
+
+/* Expands $variables, uppercases, then matches like Hyprland's
+ * stringToModMask: "SUPER_SHIFT", "SUPER SHIFT" and "SUPER+SHIFT" agree. */
+static guint16 parse_mods(const char *s, const char *e) {
+    char up[256];
+    gsize n = 0;
+    guint16 mods = 0;
+
+    while (s < e && n < sizeof(up) - 1) {
+        if (*s == '$') {
+            const char *name = ++s;
+            while (s < e && is_ident_char(*s)) s++;
+            const char *value = lookup_variable(name, s - name);
+            if (!value) {
+                mods |= KB_MOD_UNRESOLVED;
+                continue;
+            }
+            for (; *value && n < sizeof(up) - 1; value++) up[n++] = g_ascii_toupper(*value);
+            continue;
+        }
+        up[n++] = g_ascii_toupper(*s++);
+    }
+    up[n] = '\0';
+
+    if (strstr(up, "SHIFT")) mods |= KB_MOD_SHIFT;
+    if (strstr(up, "CAPS")) mods |= KB_MOD_CAPS;
+    if (strstr(up, "CTRL") || strstr(up, "CONTROL")) mods |= KB_MOD_CTRL;
+    if (strstr(up, "ALT") || strstr(up, "MOD1")) mods |= KB_MOD_ALT;
+    if (strstr(up, "MOD2")) mods |= KB_MOD_MOD2;
+    if (strstr(up, "MOD3")) mods |= KB_MOD_MOD3;
+    if (strstr(up, "SUPER") || strstr(up, "WIN") || strstr(up, "LOGO") || strstr(up, "MOD4")
+        || strstr(up, "META"))
+        mods |= KB_MOD_SUPER;
+    if (strstr(up, "MOD5")) mods |= KB_MOD_MOD5;
+    return mods;
+}
+
+void keybind_append_mods(GString *out, guint16 mods) {
+    static const struct { guint16 mask; const char *name; } names[] = {
+        { KB_MOD_SUPER, "SUPER" }, { KB_MOD_CTRL, "CTRL" }, { KB_MOD_ALT, "ALT" },
+        { KB_MOD_SHIFT, "SHIFT" }, { KB_MOD_CAPS, "CAPS" }, { KB_MOD_MOD2, "MOD2" },
+        { KB_MOD_MOD3, "MOD3" }, { KB_MOD_MOD5, "MOD5" },
+    };
+    gsize start = out->len;
+    for (gsize i = 0; i < G_N_ELEMENTS(names); i++) {
+        if (!(mods & names[i].mask)) continue;
+        if (out->len > start) g_string_append_c(out, ' ');
+        g_string_append(out, names[i].name);
+    }
+}
+
+static GQuark intern_lower(const char *s, const char *e) {
+    span_trim(&s, &e);
+    gsize len = e - s;
+    if (len == 0) return 0;
+
+    char buf[128];
+    if (len < sizeof(buf)) {
+        for (gsize i = 0; i < len; i++) buf[i] = g_ascii_tolower(s[i]);
+        buf[len] = '\0';
+        return g_quark_from_string(buf);
+    }
+
+    char *lower = g_ascii_strdown(s, len);
+    GQuark q = g_quark_from_string(lower);
+    g_free(lower);
+    return q;
+}
+
+/* ------------------------- parse ------------------------ */
+/* bind[flags] = MODS, key, [description,] dispatcher, args */
+void keybind_parse(Keybind *kb, const char *text) {
+    gsize len = strlen(text);
+    memset(kb, 0, sizeof(*kb));
+    kb->text = text;
+    kb->args_off = len;
+
+    if (strncmp(text, "bind", 4) != 0) return;
+    const char *eq = strchr(text, '=');
+    if (!eq) return;
+
+    const char *fs = text + 4, *fe = eq;
+    span_trim(&fs, &fe);
+    guint16 flags = parse_flags(fs, fe);
+    if (!flags) return;
+
+    const char *end = text + len;
+    const char *start[4], *stop[4];
+    int nfields = (flags & KB_FLAG_DESCRIPTION) ? 4 : 3;
+    const char *p = eq + 1;
+    for (int i = 0; i < nfields; i++) {
+        const char *comma = memchr(p, ',', end - p);
+        start[i] = p;
+        stop[i] = comma ? comma : end;
+        p = comma ? comma + 1 : end;
+    }
+
+    const char *args = p, *args_end = end;
+    span_trim(&args, &args_end);
+
+    kb->flags = flags;
+    kb->mods = parse_mods(start[0], stop[0]);
+    kb->key = intern_lower(start[1], stop[1]);
+    kb->dispatcher = intern_lower(start[nfields - 1], stop[nfields - 1]);
+    kb->args_off = args - text;
+    kb->args_len = args_end - args;
+}
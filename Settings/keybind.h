@@ -0,0 +1,79 @@
+#ifndef KEYBIND_H
+#define KEYBIND_H
+
+#include <glib.h>
+
+/* bind[flags] suffix letters, e.g. bindel = KB_FLAG_REPEAT | KB_FLAG_LOCKED.
+ * KB_FLAG_BIND marks a line that is a bind at all; everything else in a
+ * section (comments, variables, submaps...) is kept as plain text. */
+typedef enum {
+    KB_FLAG_LOCKED       = 1 << 0,  /* l */
+    KB_FLAG_RELEASE      = 1 << 1,  /* r */
+    KB_FLAG_REPEAT       = 1 << 2,  /* e */
+    KB_FLAG_NONCONSUMING = 1 << 3,  /* n */
+    KB_FLAG_MOUSE        = 1 << 4,  /* m */
+    KB_FLAG_TRANSPARENT  = 1 << 5,  /* t */
+    KB_FLAG_IGNORE_MODS  = 1 << 6,  /* i */
+    KB_FLAG_SEPARATE     = 1 << 7,  /* s */
+    KB_FLAG_DESCRIPTION  = 1 << 8,  /* d */
+    KB_FLAG_BYPASS       = 1 << 9,  /* p */
+    KB_FLAG_LONG_PRESS   = 1 << 10, /* o */
+    KB_FLAG_CLICK        = 1 << 11, /* c */
+    KB_FLAG_DRAG         = 1 << 12, /* g */
+    KB_FLAG_BIND         = 1 << 15,
+} KeybindFlags;
+
+/* Modifier mask, matched the way Hyprland does (substring, any separator) */
+typedef enum {
+    KB_MOD_SHIFT      = 1 << 0,
+    KB_MOD_CAPS       = 1 << 1,
+    KB_MOD_CTRL       = 1 << 2,
+    KB_MOD_ALT        = 1 << 3,
+    KB_MOD_MOD2       = 1 << 4,
+    KB_MOD_MOD3       = 1 << 5,
+    KB_MOD_SUPER      = 1 << 6,
+    KB_MOD_MOD5       = 1 << 7,
+    KB_MOD_UNRESOLVED = 1 << 15, /* a $variable we have no definition for */
+} KeybindMods;
+
+/* One line of a section. text is the original line and is what gets written
+ * back, so the structured fields never lose information; key and dispatcher
+ * are interned (lowercased) quarks and args is a span into text. id is the
+ * line's handle in the search index (keybind_search.h), line its line in
+ * the file it was last read from or written to (0 if neither). */
+typedef struct {
+    const char *text;
+    GQuark key;
+    GQuark dispatcher;
+    guint32 args_off;
+    guint32 args_len;
+    guint32 id;
+    guint32 line;
+    guint16 flags;
+    guint16 mods;
+} Keybind;
+
+/* Fill kb from a trimmed line; text must outlive kb (arena-owned) */
+void keybind_parse(Keybind *kb, const char *text);
+
+static inline gboolean keybind_is_bind(const Keybind *kb) {
+    return (kb->flags & KB_FLAG_BIND) != 0;
+}
+
+static inline const char *keybind_args(const Keybind *kb) {
+    return kb->text + kb->args_off;
+}
+
+/* Appends the modifier names of a mask, space separated ("SUPER SHIFT") */
+void keybind_append_mods(GString *out, guint16 mods);
+
+/* $name = value definitions used to resolve modifiers like $mainMod */
+void keybind_set_variable(const char *name, gsize name_len, const char *value, gsize value_len);
+/* Only a loader about to read definitions again calls this, before it
+ * does; free_keybinds() leaves them, since binds added or edited after a
+ * load still resolve against them */
+void keybind_clear_variables(void);
+/* Calls func(name, value) for every definition */
+void keybind_foreach_variable(GHFunc func, gpointer user_data);
+
+#endif // KEYBIND_H
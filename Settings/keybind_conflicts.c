@@ -0,0 +1,59 @@
+#include "keybind_conflicts.h"
+
+/* Flags that change when a bind fires; two binds differing only in other
+ * flags (locked, repeat, description...) still fight over the same chord. */
+#define CHORD_FLAGS (KB_FLAG_MOUSE | KB_FLAG_RELEASE | KB_FLAG_LONG_PRESS \
+                     | KB_FLAG_CLICK | KB_FLAG_DRAG)
+
+typedef struct {
+    guint64 chord; /* also the hash key */
+    guint count;
+} ChordEntry;
+
+static GHashTable *g_chords = NULL; /* &ChordEntry.chord -> ChordEntry */
+
+static gboolean chord_for(const Keybind *kb, guint64 *out) {
+    if (!keybind_is_bind(kb) || kb->key == 0) return FALSE;
+    *out = ((guint64)kb->key << 32) | ((guint64)(kb->flags & CHORD_FLAGS) << 16) | kb->mods;
+    return TRUE;
+}
+
+gboolean conflicts_same_chord(const Keybind *a, const Keybind *b) {
+    guint64 ca, cb;
+    return chord_for(a, &ca) && chord_for(b, &cb) && ca == cb;
+}
+
+void conflicts_clear(void) {
+    if (g_chords) g_hash_table_remove_all(g_chords);
+}
+
+void conflicts_add(const Keybind *kb) {
+    guint64 chord;
+    if (!chord_for(kb, &chord)) return;
+    if (!g_chords) g_chords = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, g_free);
+
+    ChordEntry *e = g_hash_table_lookup(g_chords, &chord);
+    if (!e) {
+        e = g_new0(ChordEntry, 1);
+        e->chord = chord;
+        g_hash_table_insert(g_chords, &e->chord, e);
+    }
+    e->count++;
+}
+
+void conflicts_remove(const Keybind *kb) {
+    guint64 chord;
+    if (!g_chords || !chord_for(kb, &chord)) return;
+
+    ChordEntry *e = g_hash_table_lookup(g_chords, &chord);
+    if (!e) return;
+    if (--e->count == 0) g_hash_table_remove(g_chords, &chord);
+}
+
+guint conflicts_count(const Keybind *kb) {
+    guint64 chord;
+    if (!g_chords || !chord_for(kb, &chord)) return 0;
+
+    ChordEntry *e = g_hash_table_lookup(g_chords, &chord);
+    return e ? e->count : 0;
+}
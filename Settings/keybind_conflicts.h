@@ -0,0 +1,18 @@
+#ifndef KEYBIND_CONFLICTS_H
+#define KEYBIND_CONFLICTS_H
+
+#include "keybind.h"
+
+/* Hash index of every bind chord (trigger flags, modifier mask, key) in the
+ * loaded model, so "is MODS+KEY already taken?" is a single lookup.
+ * Non-bind lines are ignored by all functions. */
+void conflicts_clear(void);
+void conflicts_add(const Keybind *kb);
+void conflicts_remove(const Keybind *kb);
+
+gboolean conflicts_same_chord(const Keybind *a, const Keybind *b);
+
+/* Number of binds in the model using the same chord as kb */
+guint conflicts_count(const Keybind *kb);
+
+#endif // KEYBIND_CONFLICTS_H
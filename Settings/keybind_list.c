@@ -0,0 +1,220 @@
+#include "keybind_list.h"
+#include "keybinds.h"
+
+/* ------------------------- item ------------------------ */
+struct _KbBindItem {
+    GObject parent_instance;
+    int section_index;
+    guint row;
+};
+
+G_DEFINE_TYPE(KbBindItem, kb_bind_item, G_TYPE_OBJECT)
+
+static void kb_bind_item_class_init(KbBindItemClass *klass) {
+}
+
+static void kb_bind_item_init(KbBindItem *self) {
+}
+
+static KbBindItem *kb_bind_item_new(int section_index, guint row) {
+    KbBindItem *item = g_object_new(KB_TYPE_BIND_ITEM, NULL);
+    item->section_index = section_index;
+    item->row = row;
+    return item;
+}
+
+int kb_bind_item_get_section(KbBindItem *item) {
+    return item->section_index;
+}
+
+guint kb_bind_item_get_row(KbBindItem *item) {
+    return item->row;
+}
+
+/* ------------------------- list model ------------------------ */
+struct _KbBindList {
+    GObject parent_instance;
+    GArray *offsets; /* guint, g_section_count + 1 entries: flat start of each section */
+    GArray *filter;  /* KbRowRef shown instead of everything, or NULL */
+    GArray *groups;  /* guint, start of each section group in filter + final end */
+};
+
+static void kb_bind_list_model_init(GListModelInterface *iface);
+static void kb_bind_list_section_model_init(GtkSectionModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(KbBindList, kb_bind_list, G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(G_TYPE_LIST_MODEL, kb_bind_list_model_init)
+                        G_IMPLEMENT_INTERFACE(GTK_TYPE_SECTION_MODEL, kb_bind_list_section_model_init))
+
+static guint n_items(KbBindList *self) {
+    if (self->filter) return self->filter->len;
+    if (self->offsets->len == 0) return 0;
+    return g_array_index(self->offsets, guint, self->offsets->len - 1);
+}
+
+static guint section_start(KbBindList *self, int section_index) {
+    return g_array_index(self->offsets, guint, section_index);
+}
+
+/* Binary search for the last start at or before position. Empty groups
+ * (only an empty filter has one) share their start with the next. */
+static int last_start_at_or_before(GArray *starts, guint position) {
+    int lo = 0, hi = (int)starts->len - 2;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (g_array_index(starts, guint, mid) <= position) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+static int section_for_position(KbBindList *self, guint position) {
+    return last_start_at_or_before(self->offsets, position);
+}
+
+/* Items a section takes unfiltered: its binds, or the placeholder */
+static guint section_items(int section_index) {
+    return MAX(1, g_sections[section_index].binds->len);
+}
+
+static void sync_offsets(KbBindList *self) {
+    guint pos = 0;
+    g_array_set_size(self->offsets, 0);
+    g_array_append_val(self->offsets, pos);
+    for (int i = 0; i < g_section_count; i++) {
+        pos += section_items(i);
+        g_array_append_val(self->offsets, pos);
+    }
+}
+
+static GType kb_bind_list_get_item_type(GListModel *model) {
+    return KB_TYPE_BIND_ITEM;
+}
+
+static guint kb_bind_list_get_n_items(GListModel *model) {
+    return n_items(KB_BIND_LIST(model));
+}
+
+static gpointer kb_bind_list_get_item(GListModel *model, guint position) {
+    KbBindList *self = KB_BIND_LIST(model);
+    if (position >= n_items(self)) return NULL;
+
+    if (self->filter) {
+        KbRowRef *ref = &g_array_index(self->filter, KbRowRef, position);
+        return kb_bind_item_new(ref->section_index, ref->row);
+    }
+
+    int s = section_for_position(self, position);
+    return kb_bind_item_new(s, position - section_start(self, s));
+}
+
+static void kb_bind_list_model_init(GListModelInterface *iface) {
+    iface->get_item_type = kb_bind_list_get_item_type;
+    iface->get_n_items = kb_bind_list_get_n_items;
+    iface->get_item = kb_bind_list_get_item;
+}
+
+static void kb_bind_list_get_section(GtkSectionModel *model, guint position,
+                                     guint *out_start, guint *out_end) {
+    KbBindList *self = KB_BIND_LIST(model);
+    guint n = n_items(self);
+    if (position >= n) {
+        *out_start = n;
+        *out_end = G_MAXUINT;
+        return;
+    }
+
+    GArray *starts = self->filter ? self->groups : self->offsets;
+    int s = last_start_at_or_before(starts, position);
+    *out_start = g_array_index(starts, guint, s);
+    *out_end = g_array_index(starts, guint, s + 1);
+}
+
+static void kb_bind_list_section_model_init(GtkSectionModelInterface *iface) {
+    iface->get_section = kb_bind_list_get_section;
+}
+
+static void kb_bind_list_finalize(GObject *object) {
+    KbBindList *self = KB_BIND_LIST(object);
+    g_array_unref(self->offsets);
+    g_clear_pointer(&self->filter, g_array_unref);
+    g_array_unref(self->groups);
+    G_OBJECT_CLASS(kb_bind_list_parent_class)->finalize(object);
+}
+
+static void kb_bind_list_class_init(KbBindListClass *klass) {
+    G_OBJECT_CLASS(klass)->finalize = kb_bind_list_finalize;
+}
+
+static void kb_bind_list_init(KbBindList *self) {
+    self->offsets = g_array_new(FALSE, FALSE, sizeof(guint));
+    self->groups = g_array_new(FALSE, FALSE, sizeof(guint));
+}
+
+KbBindList *kb_bind_list_new(void) {
+    KbBindList *self = g_object_new(KB_TYPE_BIND_LIST, NULL);
+    sync_offsets(self);
+    return self;
+}
+
+/* ------------------------- change notification ------------------------ */
+void kb_bind_list_reset(KbBindList *self) {
+    guint old_n = n_items(self);
+    g_clear_pointer(&self->filter, g_array_unref);
+    sync_offsets(self);
+    g_list_model_items_changed(G_LIST_MODEL(self), 0, old_n, n_items(self));
+}
+
+void kb_bind_list_set_filter(KbBindList *self, GArray *rows) {
+    guint old_n = n_items(self);
+    g_clear_pointer(&self->filter, g_array_unref);
+    g_array_set_size(self->groups, 0);
+    sync_offsets(self);
+
+    if (rows) {
+        self->filter = g_array_ref(rows);
+        for (guint i = 0; i < rows->len; i++) {
+            if (i == 0 || g_array_index(rows, KbRowRef, i).section_index
+                          != g_array_index(rows, KbRowRef, i - 1).section_index)
+                g_array_append_val(self->groups, i);
+        }
+        guint end = rows->len;
+        if (end == 0) g_array_append_val(self->groups, end);
+        g_array_append_val(self->groups, end);
+    }
+
+    g_list_model_items_changed(G_LIST_MODEL(self), 0, old_n, n_items(self));
+}
+
+gboolean kb_bind_list_is_filtered(KbBindList *self) {
+    return self->filter != NULL;
+}
+
+void kb_bind_list_row_changed(KbBindList *self, int section_index, guint row) {
+    if (self->filter) return;
+    if (section_index < 0 || (guint)section_index + 1 >= self->offsets->len) return;
+    guint pos = section_start(self, section_index) + row;
+    if (pos >= n_items(self)) return;
+    g_list_model_items_changed(G_LIST_MODEL(self), pos, 1, 1);
+}
+
+void kb_bind_list_section_changed(KbBindList *self, int section_index, guint first_row) {
+    if (self->filter) return;
+
+    /* Section layout itself changed (reparse): nothing to diff against */
+    if (section_index < 0 || section_index >= g_section_count
+        || self->offsets->len != (guint)g_section_count + 1) {
+        kb_bind_list_reset(self);
+        return;
+    }
+
+    guint start = section_start(self, section_index);
+    guint old_len = section_start(self, section_index + 1) - start;
+    sync_offsets(self);
+    guint new_len = section_items(section_index);
+
+    first_row = MIN(first_row, MIN(old_len, new_len));
+    if (old_len == first_row && new_len == first_row) return;
+    g_list_model_items_changed(G_LIST_MODEL(self), start + first_row,
+                               old_len - first_row, new_len - first_row);
+}
@@ -0,0 +1,46 @@
+#ifndef KEYBIND_LIST_H
+#define KEYBIND_LIST_H
+
+#include <gtk/gtk.h>
+
+/* One row of the keybind list: a (section, row) reference into g_sections.
+ * Items are created on demand by the model and are only valid until the
+ * next items-changed emission that covers their position. */
+#define KB_TYPE_BIND_ITEM (kb_bind_item_get_type())
+G_DECLARE_FINAL_TYPE(KbBindItem, kb_bind_item, KB, BIND_ITEM, GObject)
+
+/* GListModel + GtkSectionModel flattening g_sections into one list,
+ * one item per bind, one section per "## header". A section without binds
+ * still gets one placeholder item so its header stays visible; its row is
+ * past the section's binds. */
+#define KB_TYPE_BIND_LIST (kb_bind_list_get_type())
+G_DECLARE_FINAL_TYPE(KbBindList, kb_bind_list, KB, BIND_LIST, GObject)
+
+typedef struct {
+    int section_index;
+    guint row;
+} KbRowRef;
+
+int kb_bind_item_get_section(KbBindItem *item);
+guint kb_bind_item_get_row(KbBindItem *item);
+
+KbBindList *kb_bind_list_new(void);
+
+/* Resync with g_sections after a full (re)parse */
+void kb_bind_list_reset(KbBindList *self);
+
+/* Show only the given rows (KbRowRef, rows of one section adjacent so they
+ * form that section's group, in display order); NULL shows everything.
+ * Takes a reference on rows. While filtered, row/section_changed are
+ * ignored and the caller is expected to set a fresh filter instead. */
+void kb_bind_list_set_filter(KbBindList *self, GArray *rows);
+gboolean kb_bind_list_is_filtered(KbBindList *self);
+
+/* A single bind was replaced in place */
+void kb_bind_list_row_changed(KbBindList *self, int section_index, guint row);
+
+/* Binds were inserted or removed in a section starting at first_row;
+ * every later row of that section shifts, so the tail is re-announced. */
+void kb_bind_list_section_changed(KbBindList *self, int section_index, guint first_row);
+
+#endif // KEYBIND_LIST_H
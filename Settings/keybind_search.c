@@ -0,0 +1,280 @@
+#include "keybind_search.h"
+#include <string.h>
+
+/* Compact posting lists once this many ids are dead and they outnumber
+ * the live ones */
+#define COMPACT_MIN_DEAD 4096
+
+static GPtrArray *g_docs = NULL;       /* id -> lowercased document, NULL once removed */
+static GStringChunk *g_doc_arena = NULL;
+static GHashTable *g_postings = NULL;  /* trigram -> GArray of guint32 ids */
+static guint g_dead = 0;
+
+static GArray *g_scores = NULL;        /* id -> score of the last query */
+static GArray *g_touched = NULL;       /* ids with a non-zero entry in g_scores */
+
+/* ------------------------- trigrams ------------------------ */
+static inline guint32 trigram_at(const char *s) {
+    return ((guint32)(guchar)s[0] << 16) | ((guint32)(guchar)s[1] << 8) | (guchar)s[2];
+}
+
+static gint compare_guint32(gconstpointer a, gconstpointer b) {
+    guint32 x = *(const guint32 *)a, y = *(const guint32 *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Distinct trigrams of s into out (cleared first); none span a newline,
+ * so header, line and modifier fields do not bleed into each other */
+static void collect_trigrams(const char *s, gsize len, GArray *out) {
+    g_array_set_size(out, 0);
+    for (gsize i = 0; i + 3 <= len; i++) {
+        if (s[i] == '\n' || s[i + 1] == '\n' || s[i + 2] == '\n') continue;
+        guint32 t = trigram_at(s + i);
+        g_array_append_val(out, t);
+    }
+    g_array_sort(out, compare_guint32);
+
+    guint n = 0;
+    for (guint i = 0; i < out->len; i++) {
+        guint32 t = g_array_index(out, guint32, i);
+        if (n == 0 || g_array_index(out, guint32, n - 1) != t)
+            g_array_index(out, guint32, n++) = t;
+    }
+    g_array_set_size(out, n);
+}
+
+static void ensure_init(void) {
+    if (g_docs) return;
+    g_docs = g_ptr_array_new();
+    g_doc_arena = g_string_chunk_new(64 * 1024);
+    g_postings = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                       (GDestroyNotify)g_array_unref);
+    g_scores = g_array_new(FALSE, TRUE, sizeof(guint));
+    g_touched = g_array_new(FALSE, FALSE, sizeof(guint32));
+}
+
+/* ------------------------- index maintenance ------------------------ */
+void search_clear(void) {
+    if (!g_docs) return;
+    g_ptr_array_set_size(g_docs, 0);
+    g_string_chunk_clear(g_doc_arena);
+    g_hash_table_remove_all(g_postings);
+    g_array_set_size(g_scores, 0);
+    g_array_set_size(g_touched, 0);
+    g_dead = 0;
+}
+
+guint32 search_add(const char *header, const Keybind *kb) {
+    static GString *doc = NULL;
+    static GArray *trigrams = NULL;
+    ensure_init();
+    if (!doc) doc = g_string_sized_new(256);
+    if (!trigrams) trigrams = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+    g_string_truncate(doc, 0);
+    g_string_append(doc, header ? header : "");
+    g_string_append_c(doc, '\n');
+    g_string_append(doc, kb->text);
+    if (keybind_is_bind(kb)) {
+        g_string_append_c(doc, '\n');
+        keybind_append_mods(doc, kb->mods);
+    }
+    for (gsize i = 0; i < doc->len; i++) doc->str[i] = g_ascii_tolower(doc->str[i]);
+
+    guint32 id = g_docs->len;
+    g_ptr_array_add(g_docs, g_string_chunk_insert_len(g_doc_arena, doc->str, doc->len));
+
+    collect_trigrams(doc->str, doc->len, trigrams);
+    for (guint i = 0; i < trigrams->len; i++) {
+        gpointer key = GUINT_TO_POINTER(g_array_index(trigrams, guint32, i));
+        GArray *posting = g_hash_table_lookup(g_postings, key);
+        if (!posting) {
+            posting = g_array_new(FALSE, FALSE, sizeof(guint32));
+            g_hash_table_insert(g_postings, key, posting);
+        }
+        g_array_append_val(posting, id);
+    }
+    return id;
+}
+
+static void compact_postings(void) {
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, g_postings);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        GArray *posting = value;
+        guint n = 0;
+        for (guint i = 0; i < posting->len; i++) {
+            guint32 id = g_array_index(posting, guint32, i);
+            if (g_ptr_array_index(g_docs, id)) g_array_index(posting, guint32, n++) = id;
+        }
+        if (n == 0) g_hash_table_iter_remove(&iter);
+        else g_array_set_size(posting, n);
+    }
+    g_dead = 0;
+}
+
+void search_remove(guint32 id) {
+    if (!g_docs || id >= g_docs->len || !g_ptr_array_index(g_docs, id)) return;
+    g_ptr_array_index(g_docs, id) = NULL;
+    g_dead++;
+    if (g_dead >= COMPACT_MIN_DEAD && g_dead > g_docs->len - g_dead) compact_postings();
+}
+
+/* ------------------------- queries ------------------------ */
+static void reset_scores(void) {
+    for (guint i = 0; i < g_touched->len; i++)
+        g_array_index(g_scores, guint, g_array_index(g_touched, guint32, i)) = 0;
+    g_array_set_size(g_touched, 0);
+    if (g_scores->len < g_docs->len) g_array_set_size(g_scores, g_docs->len);
+}
+
+/* Substring hits rank above trigram-only hits, earlier hits above later */
+static guint substring_score(const char *doc, const char *q) {
+    const char *hit = strstr(doc, q);
+    if (!hit) return 0;
+    return 1000 - MIN((guint)(hit - doc), 200u);
+}
+
+guint search_query(const char *query) {
+    ensure_init();
+    reset_scores();
+
+    char *q = g_ascii_strdown(query ? query : "", -1);
+    g_strstrip(q);
+    gsize qlen = strlen(q);
+    guint hits = 0;
+
+    if (qlen == 0) {
+        g_free(q);
+        return 0;
+    }
+
+    if (qlen < 3) {
+        for (guint32 id = 0; id < g_docs->len; id++) {
+            const char *doc = g_ptr_array_index(g_docs, id);
+            guint score = doc ? substring_score(doc, q) : 0;
+            if (!score) continue;
+            g_array_index(g_scores, guint, id) = score;
+            g_array_append_val(g_touched, id);
+            hits++;
+        }
+        g_free(q);
+        return hits;
+    }
+
+    /* count shared trigrams per candidate, straight from the postings */
+    GArray *trigrams = g_array_new(FALSE, FALSE, sizeof(guint32));
+    collect_trigrams(q, qlen, trigrams);
+    for (guint i = 0; i < trigrams->len; i++) {
+        GArray *posting = g_hash_table_lookup(g_postings,
+                                              GUINT_TO_POINTER(g_array_index(trigrams, guint32, i)));
+        if (!posting) continue;
+        for (guint j = 0; j < posting->len; j++) {
+            guint32 id = g_array_index(posting, guint32, j);
+            if (!g_ptr_array_index(g_docs, id)) continue;
+            if (g_array_index(g_scores, guint, id)++ == 0) g_array_append_val(g_touched, id);
+        }
+    }
+
+    guint ntri = MAX(trigrams->len, 1u);
+    guint threshold = (ntri + 1) / 2;
+    for (guint i = 0; i < g_touched->len; i++) {
+        guint32 id = g_array_index(g_touched, guint32, i);
+        guint shared = g_array_index(g_scores, guint, id);
+        guint score = 0;
+        if (shared >= threshold) {
+            score = shared * 500 / ntri + substring_score(g_ptr_array_index(g_docs, id), q);
+            hits++;
+        }
+        g_array_index(g_scores, guint, id) = score;
+    }
+
+    g_array_unref(trigrams);
+    g_free(q);
+    return hits;
+}
+
+guint search_score(guint32 id) {
+    if (!g_scores || id >= g_scores->len) return 0;
+    return g_array_index(g_scores, guint, id);
+}
+
+/* ------------------------- persistence ------------------------ */
+/* Native byte order: the blob never leaves the machine that wrote it */
+#define DOC_REMOVED G_MAXUINT32
+
+static void put_u32(GByteArray *out, guint32 v) {
+    g_byte_array_append(out, (const guint8 *)&v, sizeof(v));
+}
+
+static gboolean get_u32(const guint8 **p, const guint8 *end, guint32 *v) {
+    if ((gsize)(end - *p) < sizeof(*v)) return FALSE;
+    memcpy(v, *p, sizeof(*v));
+    *p += sizeof(*v);
+    return TRUE;
+}
+
+void search_save(GByteArray *out) {
+    ensure_init();
+    put_u32(out, g_docs->len);
+    for (guint32 id = 0; id < g_docs->len; id++) {
+        const char *doc = g_ptr_array_index(g_docs, id);
+        if (!doc) {
+            put_u32(out, DOC_REMOVED);
+            continue;
+        }
+        guint32 len = strlen(doc);
+        put_u32(out, len);
+        g_byte_array_append(out, (const guint8 *)doc, len);
+    }
+
+    put_u32(out, g_hash_table_size(g_postings));
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, g_postings);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        GArray *posting = value;
+        put_u32(out, GPOINTER_TO_UINT(key));
+        put_u32(out, posting->len);
+        g_byte_array_append(out, (const guint8 *)posting->data, posting->len * sizeof(guint32));
+    }
+}
+
+static gboolean load_index(const guint8 *p, const guint8 *end) {
+    guint32 n_docs, doc_len;
+    if (!get_u32(&p, end, &n_docs)) return FALSE;
+    for (guint32 id = 0; id < n_docs; id++) {
+        if (!get_u32(&p, end, &doc_len)) return FALSE;
+        if (doc_len == DOC_REMOVED) {
+            g_ptr_array_add(g_docs, NULL);
+            g_dead++;
+            continue;
+        }
+        if ((gsize)(end - p) < doc_len) return FALSE;
+        g_ptr_array_add(g_docs, g_string_chunk_insert_len(g_doc_arena, (const char *)p, doc_len));
+        p += doc_len;
+    }
+
+    guint32 n_postings, trigram, count;
+    if (!get_u32(&p, end, &n_postings)) return FALSE;
+    for (guint32 i = 0; i < n_postings; i++) {
+        if (!get_u32(&p, end, &trigram) || !get_u32(&p, end, &count)) return FALSE;
+        if ((gsize)(end - p) / sizeof(guint32) < count) return FALSE;
+        GArray *posting = g_array_sized_new(FALSE, FALSE, sizeof(guint32), count);
+        g_array_append_vals(posting, p, count);
+        p += count * sizeof(guint32);
+        g_hash_table_insert(g_postings, GUINT_TO_POINTER(trigram), posting);
+        for (guint32 j = 0; j < count; j++)
+            if (g_array_index(posting, guint32, j) >= n_docs) return FALSE;
+    }
+    return p == end;
+}
+
+gboolean search_load(const guint8 *data, gsize len) {
+    ensure_init();
+    search_clear();
+    if (load_index(data, data + len)) return TRUE;
+    search_clear();
+    return FALSE;
+}
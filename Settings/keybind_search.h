@@ -0,0 +1,29 @@
+#ifndef KEYBIND_SEARCH_H
+#define KEYBIND_SEARCH_H
+
+#include "keybind.h"
+
+/* Trigram index over every line of the model. Each indexed line gets an id
+ * (stored in Keybind.id); its document is the section header, the line and
+ * its resolved modifier names, lowercased. Removal only tombstones the id,
+ * the posting lists are compacted once enough ids are dead. */
+void search_clear(void);
+guint32 search_add(const char *header, const Keybind *kb);
+void search_remove(guint32 id);
+
+/* Runs a query and returns the number of hits. Short queries (< 3 chars)
+ * fall back to a substring scan; longer ones accept documents sharing at
+ * least half of the query's trigrams, so small typos still match. */
+guint search_query(const char *query);
+
+/* Rank of id in the last query, 0 when it did not match */
+guint search_score(guint32 id);
+
+/* The whole index as a flat blob (documents, then posting lists), for the
+ * parsed-config cache. search_load() replaces the index with one saved
+ * this way; on a malformed blob it leaves the index empty and returns
+ * FALSE. */
+void search_save(GByteArray *out);
+gboolean search_load(const guint8 *data, gsize len);
+
+#endif // KEYBIND_SEARCH_H
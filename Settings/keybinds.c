@@ -1,16 +1,24 @@
 #include "keybinds.h"
+#include "keybind_list.h"
+#include "keybind_conflicts.h"
+#include "keybind_search.h"
+#include "keybinds_journal.h"
+#include "stats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 /* ------------------------- globals ------------------------ */
-Section *g_sections = NULL;
-int g_section_count = 0;
-char g_filepath[512];
-GPtrArray *preamble_lines = NULL;
 GtkWidget *g_main_box = NULL;
 GtkWidget *g_app_window = NULL;
 
+static KbBindList *g_bind_list = NULL;
+static GHashTable *g_bound_rows = NULL; /* GtkListItem currently showing a bind */
+static char *g_search_query = NULL;
+static GtkWidget *g_undo_button = NULL;
+static GtkWidget *g_redo_button = NULL;
+static GtkWidget *g_save_label = NULL;
+
 /* ------------------------- utilities ------------------------ */
 static char *trim(char *str) {
     while (*str == ' ' || *str == '\t') str++;
@@ -22,165 +30,281 @@ static char *trim(char *str) {
     return str;
 }
 
-static gboolean is_blank(const char *s) {
-    if (!s) return TRUE;
-    while (*s) {
-        if (*s != ' ' && *s != '\t' && *s != '\r' && *s != '\n') return FALSE;
-        s++;
-    }
-    return TRUE;
+/* ------------------------- search ------------------------ */
+typedef struct {
+    guint section_best; /* best score in the row's section: orders the groups */
+    guint score;
+    KbRowRef ref;
+} ScoredRow;
+
+static gint compare_scored_rows(gconstpointer pa, gconstpointer pb) {
+    const ScoredRow *a = pa, *b = pb;
+    if (a->section_best != b->section_best) return a->section_best > b->section_best ? -1 : 1;
+    if (a->ref.section_index != b->ref.section_index) return a->ref.section_index - b->ref.section_index;
+    if (a->score != b->score) return a->score > b->score ? -1 : 1;
+    return a->ref.row < b->ref.row ? -1 : a->ref.row > b->ref.row;
 }
 
-/* ------------------------- parse & rewrite ------------------------ */
-Section *parse_keybinds(const char *filepath, int *out_section_count) {
-    FILE *f = fopen(filepath, "r");
-    if (!f) return NULL;
-
-    if (preamble_lines) g_ptr_array_free(preamble_lines, TRUE);
-    preamble_lines = g_ptr_array_new_with_free_func(g_free);
-
-    int capacity = 8;
-    Section *sections = malloc(capacity * sizeof(Section));
-    *out_section_count = 0;
-
-    char line[MAX_LINE_LENGTH];
-    gboolean seen_first_section = FALSE;
-
-    while (fgets(line, sizeof(line), f)) {
-        if (!seen_first_section) {
-            if (strncmp(line, "##", 2) == 0) {
-                seen_first_section = TRUE;
-                char *header = trim(line + 2);
-                strncpy(sections[*out_section_count].header, header, sizeof(sections[*out_section_count].header)-1);
-                sections[*out_section_count].header[sizeof(sections[*out_section_count].header)-1] = '\0';
-                sections[*out_section_count].buttons = g_ptr_array_new_with_free_func(g_free);
-                (*out_section_count)++;
-            } else {
-                g_ptr_array_add(preamble_lines, g_strdup(line));
-            }
-            continue;
-        }
+/* Re-run the current query against the index and show the ranked hits,
+ * grouped under their section headers. Only the list model changes. */
+static void apply_search(void) {
+    if (!g_bind_list) return;
+    if (!g_search_query || !*g_search_query) {
+        if (kb_bind_list_is_filtered(g_bind_list)) kb_bind_list_set_filter(g_bind_list, NULL);
+        return;
+    }
 
-        char *t = trim(line);
-        if (strlen(t) == 0) continue;
-
-        if (strncmp(t, "##", 2) == 0) {
-            if (*out_section_count == capacity) {
-                capacity *= 2;
-                sections = realloc(sections, capacity * sizeof(Section));
-            }
-            char *header = trim(t + 2);
-            strncpy(sections[*out_section_count].header, header, sizeof(sections[*out_section_count].header)-1);
-            sections[*out_section_count].header[sizeof(sections[*out_section_count].header)-1] = '\0';
-            sections[*out_section_count].buttons = g_ptr_array_new_with_free_func(g_free);
-            (*out_section_count)++;
-        } else if (strncmp(t, "bind", 4) == 0 || strncmp(t, "bindm", 5) == 0
-                   || strncmp(t, "bindel", 6) == 0 || strncmp(t, "bindl", 5) == 0) {
-            if (!is_blank(t))
-                g_ptr_array_add(sections[*out_section_count-1].buttons, g_strdup(t));
-        } else {
-            if (!is_blank(t))
-                g_ptr_array_add(sections[*out_section_count-1].buttons, g_strdup(t));
+    guint hits = search_query(g_search_query);
+    GArray *scored = g_array_sized_new(FALSE, FALSE, sizeof(ScoredRow), hits);
+    for (int i = 0; i < g_section_count && hits > 0; i++) {
+        GArray *binds = g_sections[i].binds;
+        guint first = scored->len, best = 0;
+        for (guint j = 0; j < binds->len; j++) {
+            guint score = search_score(g_array_index(binds, Keybind, j).id);
+            if (!score) continue;
+            ScoredRow r = { 0, score, { i, j } };
+            g_array_append_val(scored, r);
+            best = MAX(best, score);
         }
+        for (guint k = first; k < scored->len; k++)
+            g_array_index(scored, ScoredRow, k).section_best = best;
     }
+    g_array_sort(scored, compare_scored_rows);
+
+    GArray *rows = g_array_sized_new(FALSE, FALSE, sizeof(KbRowRef), scored->len);
+    for (guint k = 0; k < scored->len; k++)
+        g_array_append_val(rows, g_array_index(scored, ScoredRow, k).ref);
+    kb_bind_list_set_filter(g_bind_list, rows);
 
-    fclose(f);
-    return sections;
+    g_array_unref(rows);
+    g_array_unref(scored);
 }
 
-void rewrite_config(const char *filepath, Section *sections, int section_count) {
-    FILE *f = fopen(filepath, "w");
-    if (!f) return;
+static void on_search_changed(GtkSearchEntry *entry, gpointer user_data) {
+    g_free(g_search_query);
+    g_search_query = g_strdup(gtk_editable_get_text(GTK_EDITABLE(entry)));
+    apply_search();
+}
 
-    if (preamble_lines) {
-        for (size_t i = 0; i < preamble_lines->len; i++) {
-            fprintf(f, "%s", g_ptr_array_index(preamble_lines, i));
-        }
+/* List notifications after an edit; a filtered list is re-queried instead */
+static void list_section_changed(int section_index, guint first_row) {
+    if (!g_bind_list) return;
+    if (kb_bind_list_is_filtered(g_bind_list)) apply_search();
+    else kb_bind_list_section_changed(g_bind_list, section_index, first_row);
+}
+
+static void list_row_changed(int section_index, guint row) {
+    if (!g_bind_list) return;
+    if (kb_bind_list_is_filtered(g_bind_list)) apply_search();
+    else kb_bind_list_row_changed(g_bind_list, section_index, row);
+}
+
+/* ------------------------- UI helpers ------------------------ */
+static void update_row_conflict(GtkListItem *list_item);
+
+static void update_undo_buttons(void) {
+    if (g_undo_button) gtk_widget_set_sensitive(g_undo_button, journal_can_undo());
+    if (g_redo_button) gtk_widget_set_sensitive(g_redo_button, journal_can_redo());
+}
+
+/* Pull in external edits before touching the model. FALSE when the section
+ * about to be modified was itself changed on disk (or the layout changed):
+ * the reloaded rows are shown and the stale edit is dropped. */
+static gboolean sync_before_edit(int section_index) {
+    if (section_index < 0 || section_index >= g_section_count) return FALSE;
+    int count = g_section_count;
+    guint64 before = g_sections[section_index].hash;
+    if (!keybinds_reload_if_changed()) return TRUE;
+
+    if (g_section_count != count || g_sections[section_index].hash != before) {
+        g_printerr("%s changed on disk; reloaded it instead of applying the edit\n", g_filepath);
+        return FALSE;
     }
+    return TRUE;
+}
 
-    for (int i = 0; i < section_count; i++) {
-        fprintf(f, "## %s\n", sections[i].header);
-        GPtrArray *btns = sections[i].buttons;
-        for (size_t j = 0; j < btns->len; j++) {
-            char *line = g_ptr_array_index(btns, j);
-            if (!line) continue;
-            if (is_blank(line)) continue;
-            fprintf(f, "%s\n", line);
-        }
+/* Conflict state of a chord changed; only rows on screen need repainting */
+static void refresh_conflict_highlights(void) {
+    if (!g_bound_rows) return;
+    GHashTableIter iter;
+    gpointer list_item;
+    g_hash_table_iter_init(&iter, g_bound_rows);
+    while (g_hash_table_iter_next(&iter, &list_item, NULL))
+        update_row_conflict(GTK_LIST_ITEM(list_item));
+}
+
+/* Live "already bound" warning under a dialog's entry. For the edit dialog
+ * `self` is the bind being edited, which must not conflict with itself. */
+typedef struct {
+    GtkWidget *label;
+    Keybind self;
+    gboolean has_self;
+} ConflictCheck;
+
+static void on_bind_entry_changed(GtkEditable *editable, gpointer user_data) {
+    ConflictCheck *cc = user_data;
+    char *text = g_strdup(gtk_editable_get_text(editable));
+    Keybind kb;
+    keybind_parse(&kb, trim(text));
+
+    guint count = conflicts_count(&kb);
+    if (cc->has_self && count > 0 && conflicts_same_chord(&kb, &cc->self)) count--;
+    g_free(text);
+
+    if (count == 0) {
+        gtk_widget_remove_css_class(GTK_WIDGET(editable), "error");
+        gtk_widget_set_visible(cc->label, FALSE);
+        return;
     }
 
-    fclose(f);
+    char *msg = g_strdup_printf("Already bound: %u other bind%s use%s this key combination",
+                                count, count == 1 ? "" : "s", count == 1 ? "s" : "");
+    gtk_label_set_text(GTK_LABEL(cc->label), msg);
+    g_free(msg);
+    gtk_widget_add_css_class(GTK_WIDGET(editable), "error");
+    gtk_widget_set_visible(cc->label, TRUE);
 }
 
-/* ------------------------- UI helpers ------------------------ */
-static void clear_box_children(GtkWidget *box_widget) {
-    GtkBox *box = GTK_BOX(box_widget);
-    GtkWidget *child = gtk_widget_get_first_child(box_widget);
-    while (child) {
-        GtkWidget *next = gtk_widget_get_next_sibling(child);
-        gtk_box_remove(box, child);
-        child = next;
+static GtkWidget *attach_conflict_check(GtkWidget *entry, const Keybind *self) {
+    GtkWidget *label = gtk_label_new(NULL);
+    gtk_widget_set_halign(label, GTK_ALIGN_START);
+    gtk_widget_add_css_class(label, "error");
+    gtk_widget_set_visible(label, FALSE);
+
+    ConflictCheck *cc = g_new0(ConflictCheck, 1);
+    cc->label = label;
+    if (self) {
+        cc->self = *self;
+        cc->has_self = TRUE;
     }
+    g_signal_connect_data(entry, "changed", G_CALLBACK(on_bind_entry_changed), cc,
+                          (GClosureNotify)g_free, 0);
+    return label;
+}
+
+static gboolean context_from_list_item(GtkListItem *list_item, ButtonContext *out) {
+    KbBindItem *item = gtk_list_item_get_item(list_item);
+    if (!item) return FALSE;
+    out->section_index = kb_bind_item_get_section(item);
+    out->button_index = kb_bind_item_get_row(item);
+    if (out->section_index < 0 || out->section_index >= g_section_count) return FALSE;
+    return (guint)out->button_index < g_sections[out->section_index].binds->len;
 }
 
 static void on_delete_button_clicked(GtkButton *button, gpointer user_data) {
-    ButtonContext *ctx = g_object_get_data(G_OBJECT(button), "button-ctx");
-    if (!ctx) return;
-    GPtrArray *arr = ctx->sections[ctx->section_index].buttons;
-    if (!arr) return;
-    if ((size_t)ctx->button_index >= arr->len) return;
-    g_ptr_array_remove_index(arr, ctx->button_index);
-    rewrite_config(ctx->filepath, ctx->sections, ctx->section_count);
-    rebuild_ui();
+    ButtonContext ctx;
+    if (!context_from_list_item(GTK_LIST_ITEM(user_data), &ctx)) return;
+    if (!sync_before_edit(ctx.section_index)) return;
+    const Keybind *kb = &g_array_index(g_sections[ctx.section_index].binds, Keybind, ctx.button_index);
+    char *old_text = g_strdup(kb->text);
+    model_remove_bind(ctx.section_index, ctx.button_index);
+    journal_record(JOURNAL_DELETE, ctx.section_index, ctx.button_index, old_text, NULL);
+    keybinds_save_later();
+    g_free(old_text);
+    list_section_changed(ctx.section_index, ctx.button_index);
+    refresh_conflict_highlights();
+    update_undo_buttons();
 }
 
 /* ----- edit existing bind dialog ----- */
+/* The dialog outlives reloads: the file monitor may re-read the file while
+ * it is open, so (section, row) is only a hint. The header and line it was
+ * opened on decide which bind the edit applies to. */
 typedef struct {
-    ButtonContext *bctx;
+    ButtonContext bctx;
+    char *header;    /* section header when opened */
+    char *old_text;  /* the line when opened */
     GtkWidget *dialog;
     GtkWidget *entry;
 } EditDialogData;
 
+static void edit_dialog_data_free(gpointer data, GClosure *closure) {
+    EditDialogData *d = data;
+    g_free(d->header);
+    g_free(d->old_text);
+    g_free(d);
+}
+
+static gboolean row_holds(int section_index, guint row, const char *text) {
+    GArray *binds = g_sections[section_index].binds;
+    return row < binds->len && g_strcmp0(g_array_index(binds, Keybind, row).text, text) == 0;
+}
+
+/* Finds the bind the dialog was opened on after whatever reloads happened
+ * meanwhile: the same line in the section with the same header, at its old
+ * row or else the nearest one. FALSE when it is gone or was changed. */
+static gboolean resolve_edited_bind(EditDialogData *d) {
+    ButtonContext *ctx = &d->bctx;
+    int section = -1;
+    if (ctx->section_index < g_section_count && strcmp(g_sections[ctx->section_index].header, d->header) == 0)
+        section = ctx->section_index;
+    for (int i = 0; i < g_section_count && section < 0; i++)
+        if (strcmp(g_sections[i].header, d->header) == 0) section = i;
+    if (section < 0) return FALSE;
+
+    guint len = g_sections[section].binds->len;
+    guint row = ctx->button_index;
+    for (guint dist = 0; dist <= MAX(row, len); dist++) {
+        if (row + dist < len && row_holds(section, row + dist, d->old_text)) {
+            row += dist;
+            break;
+        }
+        if (dist <= row && row - dist < len && row_holds(section, row - dist, d->old_text)) {
+            row -= dist;
+            break;
+        }
+    }
+    if (!row_holds(section, row, d->old_text)) return FALSE;
+
+    ctx->section_index = section;
+    ctx->button_index = row;
+    return TRUE;
+}
+
 static void on_edit_ok(GtkWidget *w, gpointer user_data) {
     EditDialogData *d = user_data;
-    ButtonContext *ctx = d->bctx;
+    ButtonContext *ctx = &d->bctx;
 
     gchar *new_text = NULL;
     g_object_get(d->entry, "text", &new_text, NULL);
     if (!new_text) new_text = g_strdup("");
 
     char *trimmed = trim(new_text);
-    GPtrArray *arr = ctx->sections[ctx->section_index].buttons;
-    if ((size_t)ctx->button_index >= arr->len) {
+    keybinds_reload_if_changed();
+    if (!resolve_edited_bind(d)) {
+        g_printerr("\"%s\" changed on disk while it was being edited; kept the file's version\n", d->old_text);
         g_free(new_text);
         gtk_window_destroy(GTK_WINDOW(d->dialog));
-        g_free(d);
         return;
     }
 
-    char *old = g_ptr_array_index(arr, ctx->button_index);
+    const Keybind *kb = &g_array_index(g_sections[ctx->section_index].binds, Keybind, ctx->button_index);
+    char *old_text = g_strdup(kb->text);
     if (strlen(trimmed) == 0) {
-        g_ptr_array_remove_index(arr, ctx->button_index);
-    } else {
-        if (old) g_free(old);
-        g_ptr_array_index(arr, ctx->button_index) = g_strdup(trimmed);
+        model_remove_bind(ctx->section_index, ctx->button_index);
+        journal_record(JOURNAL_DELETE, ctx->section_index, ctx->button_index, old_text, NULL);
+        keybinds_save_later();
+        list_section_changed(ctx->section_index, ctx->button_index);
+    } else if (strcmp(old_text, trimmed) != 0) {
+        model_replace_bind(ctx->section_index, ctx->button_index, trimmed);
+        journal_record(JOURNAL_EDIT, ctx->section_index, ctx->button_index, old_text, trimmed);
+        keybinds_save_later();
+        list_row_changed(ctx->section_index, ctx->button_index);
     }
-
-    rewrite_config(ctx->filepath, ctx->sections, ctx->section_count);
-    rebuild_ui();
+    g_free(old_text);
+    refresh_conflict_highlights();
+    update_undo_buttons();
 
     g_free(new_text);
     gtk_window_destroy(GTK_WINDOW(d->dialog));
-    g_free(d);
 }
 
 static void on_edit_cancel(GtkWidget *w, gpointer user_data) {
     EditDialogData *d = user_data;
     gtk_window_destroy(GTK_WINDOW(d->dialog));
-    g_free(d);
 }
 
-static void open_edit_dialog_for(ButtonContext *ctx) {
+static void open_edit_dialog_for(const ButtonContext *ctx) {
     GtkWidget *dialog = gtk_window_new();
     gtk_window_set_title(GTK_WINDOW(dialog), "Edit Keybind");
     gtk_window_set_transient_for(GTK_WINDOW(dialog), GTK_WINDOW(g_app_window));
@@ -194,15 +318,16 @@ static void open_edit_dialog_for(ButtonContext *ctx) {
     gtk_widget_set_margin_end(vbox, 12);
     gtk_window_set_child(GTK_WINDOW(dialog), vbox);
 
-    const char *cur = NULL;
-    GPtrArray *arr = ctx->sections[ctx->section_index].buttons;
+    const Keybind *cur = NULL;
+    GArray *arr = g_sections[ctx->section_index].binds;
     if ((size_t)ctx->button_index < arr->len)
-        cur = g_ptr_array_index(arr, ctx->button_index);
+        cur = &g_array_index(arr, Keybind, ctx->button_index);
 
     GtkWidget *entry = gtk_entry_new();
-    g_object_set(entry, "text", cur ? cur : "", NULL);
     gtk_entry_set_activates_default(GTK_ENTRY(entry), TRUE);
     gtk_box_append(GTK_BOX(vbox), entry);
+    gtk_box_append(GTK_BOX(vbox), attach_conflict_check(entry, cur));
+    g_object_set(entry, "text", cur ? cur->text : "", NULL);
 
     GtkWidget *hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 8);
     gtk_box_append(GTK_BOX(vbox), hbox);
@@ -216,21 +341,24 @@ static void open_edit_dialog_for(ButtonContext *ctx) {
     gtk_box_append(GTK_BOX(hbox), btn_ok);
 
     EditDialogData *d = g_new0(EditDialogData, 1);
-    d->bctx = ctx;
+    d->bctx = *ctx;
+    d->header = g_strdup(g_sections[ctx->section_index].header);
+    d->old_text = g_strdup(cur ? cur->text : "");
     d->dialog = dialog;
     d->entry = entry;
 
-    g_signal_connect(btn_ok, "clicked", G_CALLBACK(on_edit_ok), d);
+    /* freed with the dialog, however it is closed */
+    g_signal_connect_data(btn_ok, "clicked", G_CALLBACK(on_edit_ok), d, edit_dialog_data_free, 0);
     g_signal_connect(btn_cancel, "clicked", G_CALLBACK(on_edit_cancel), d);
 
     gtk_window_present(GTK_WINDOW(dialog));
 }
 
-/* ----- existing button click handler ----- */
+/* ----- existing button click handler (user_data is the row's GtkListItem) ----- */
 void on_existing_button_clicked(GtkButton *button, gpointer user_data) {
-    ButtonContext *ctx = g_object_get_data(G_OBJECT(button), "button-ctx");
-    if (!ctx) return;
-    open_edit_dialog_for(ctx);
+    ButtonContext ctx;
+    if (!context_from_list_item(GTK_LIST_ITEM(user_data), &ctx)) return;
+    open_edit_dialog_for(&ctx);
 }
 
 /* ----- add new bind dialog ----- */
@@ -251,28 +379,32 @@ static void on_add_ok(GtkWidget *w, gpointer user_data) {
     if (strlen(trimmed) == 0) {
         g_free(bind_text);
         gtk_window_destroy(GTK_WINDOW(d->dialog));
-        g_free(d);
         return;
     }
 
     gint active = gtk_combo_box_get_active(GTK_COMBO_BOX(d->section_combo));
     if (active < 0) active = 0;
+    if (!sync_before_edit(active)) {
+        g_free(bind_text);
+        gtk_window_destroy(GTK_WINDOW(d->dialog));
+        return;
+    }
 
-    GPtrArray *arr = g_sections[active].buttons;
-    g_ptr_array_add(arr, g_strdup(trimmed));
+    guint row = model_append_bind(active, trimmed);
 
-    rewrite_config(g_filepath, g_sections, g_section_count);
-    rebuild_ui();
+    journal_record(JOURNAL_ADD, active, row, NULL, trimmed);
+    keybinds_save_later();
+    list_section_changed(active, row);
+    refresh_conflict_highlights();
+    update_undo_buttons();
 
     g_free(bind_text);
     gtk_window_destroy(GTK_WINDOW(d->dialog));
-    g_free(d);
 }
 
 static void on_add_cancel(GtkWidget *w, gpointer user_data) {
     AddDialogData *d = user_data;
     gtk_window_destroy(GTK_WINDOW(d->dialog));
-    g_free(d);
 }
 
 void open_add_dialog(void) {
@@ -292,6 +424,7 @@ void open_add_dialog(void) {
     GtkWidget *entry = gtk_entry_new();
     gtk_entry_set_placeholder_text(GTK_ENTRY(entry), "Enter new bind line e.g. bind = SUPER+ALT, exec, your-command");
     gtk_box_append(GTK_BOX(vbox), entry);
+    gtk_box_append(GTK_BOX(vbox), attach_conflict_check(entry, NULL));
 
     GtkWidget *combo = gtk_combo_box_text_new();
     for (int i = 0; i < g_section_count; ++i)
@@ -315,59 +448,352 @@ void open_add_dialog(void) {
     d->entry = entry;
     d->section_combo = combo;
 
-    g_signal_connect(btn_ok, "clicked", G_CALLBACK(on_add_ok), d);
+    /* freed with the dialog, however it is closed */
+    g_signal_connect_data(btn_ok, "clicked", G_CALLBACK(on_add_ok), d, (GClosureNotify)g_free, 0);
     g_signal_connect(btn_cancel, "clicked", G_CALLBACK(on_add_cancel), d);
 
     gtk_window_present(GTK_WINDOW(dialog));
 }
 
+/* ----- list view rows ----- */
+static void on_row_setup(GtkSignalListItemFactory *factory, GtkListItem *list_item, gpointer user_data) {
+    GtkWidget *hrow = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 8);
+    gtk_widget_set_hexpand(hrow, TRUE);
+    gtk_widget_set_margin_top(hrow, 3);
+    gtk_widget_set_margin_bottom(hrow, 3);
+
+    GtkWidget *button = gtk_button_new_with_label("");
+    g_signal_connect(button, "clicked", G_CALLBACK(on_existing_button_clicked), list_item);
+    gtk_box_append(GTK_BOX(hrow), button);
+
+    GtkWidget *del_btn = gtk_button_new_with_label("Delete");
+    g_signal_connect(del_btn, "clicked", G_CALLBACK(on_delete_button_clicked), list_item);
+    gtk_box_append(GTK_BOX(hrow), del_btn);
+
+    gtk_list_item_set_child(list_item, hrow);
+    gtk_list_item_set_activatable(list_item, FALSE);
+}
+
+/* The tooltip says where the bind lives, "file:line", and whether another
+ * bind shares its key combination */
+static void update_row_conflict(GtkListItem *list_item) {
+    ButtonContext ctx;
+    GtkWidget *button = gtk_widget_get_first_child(gtk_list_item_get_child(list_item));
+    if (!context_from_list_item(list_item, &ctx)) {
+        gtk_widget_remove_css_class(button, "error");
+        gtk_widget_set_tooltip_text(button, NULL);
+        return;
+    }
+
+    guint line;
+    const char *path = keybinds_locate(ctx.section_index, ctx.button_index, &line);
+    GString *tooltip = g_string_new(path);
+    if (line) g_string_append_printf(tooltip, ":%u", line);
+    if (conflicts_count(&g_array_index(g_sections[ctx.section_index].binds, Keybind, ctx.button_index)) > 1) {
+        gtk_widget_add_css_class(button, "error");
+        g_string_append(tooltip, "\nAnother bind uses the same key combination");
+    } else {
+        gtk_widget_remove_css_class(button, "error");
+    }
+    gtk_widget_set_tooltip_text(button, tooltip->str);
+    g_string_free(tooltip, TRUE);
+}
+
+static void on_row_bind(GtkSignalListItemFactory *factory, GtkListItem *list_item, gpointer user_data) {
+    ButtonContext ctx;
+    GtkWidget *button = gtk_widget_get_first_child(gtk_list_item_get_child(list_item));
+    GtkWidget *del_btn = gtk_widget_get_last_child(gtk_list_item_get_child(list_item));
+    gboolean has_bind = context_from_list_item(list_item, &ctx);
+    gtk_widget_set_sensitive(button, has_bind);
+    gtk_widget_set_visible(del_btn, has_bind);
+    if (!has_bind) {
+        /* the placeholder of a section without binds */
+        gtk_button_set_label(GTK_BUTTON(button), "No binds in this section");
+        return;
+    }
+    const Keybind *kb = &g_array_index(g_sections[ctx.section_index].binds, Keybind, ctx.button_index);
+    gtk_button_set_label(GTK_BUTTON(button), kb->text);
+
+    if (!g_bound_rows) g_bound_rows = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_hash_table_add(g_bound_rows, list_item);
+    update_row_conflict(list_item);
+}
+
+static void on_row_unbind(GtkSignalListItemFactory *factory, GtkListItem *list_item, gpointer user_data) {
+    if (g_bound_rows) g_hash_table_remove(g_bound_rows, list_item);
+}
+
+static void on_header_setup(GtkSignalListItemFactory *factory, GtkListHeader *header, gpointer user_data) {
+    GtkWidget *header_label = gtk_label_new(NULL);
+    gtk_widget_set_halign(header_label, GTK_ALIGN_START);
+    gtk_widget_set_margin_top(header_label, 12);
+    gtk_list_header_set_child(header, header_label);
+}
+
+static void on_header_bind(GtkSignalListItemFactory *factory, GtkListHeader *header, gpointer user_data) {
+    KbBindItem *item = gtk_list_header_get_item(header);
+    GtkWidget *header_label = gtk_list_header_get_child(header);
+    if (!item) return;
+
+    int s = kb_bind_item_get_section(item);
+    if (s < 0 || s >= g_section_count) return;
+    /* sections from sourced files say which one */
+    char *markup;
+    if (g_sections[s].file > 0) {
+        char *name = g_path_get_basename(g_files[g_sections[s].file].path);
+        markup = g_markup_printf_escaped("<b>%s</b>  <small>%s</small>", g_sections[s].header, name);
+        g_free(name);
+    } else {
+        markup = g_markup_printf_escaped("<b>%s</b>", g_sections[s].header);
+    }
+    gtk_label_set_markup(GTK_LABEL(header_label), markup);
+    g_free(markup);
+}
+
+static GtkWidget *create_bind_list_view(void) {
+    g_bind_list = kb_bind_list_new();
+
+    GtkListItemFactory *factory = gtk_signal_list_item_factory_new();
+    g_signal_connect(factory, "setup", G_CALLBACK(on_row_setup), NULL);
+    g_signal_connect(factory, "bind", G_CALLBACK(on_row_bind), NULL);
+    g_signal_connect(factory, "unbind", G_CALLBACK(on_row_unbind), NULL);
+
+    GtkListItemFactory *header_factory = gtk_signal_list_item_factory_new();
+    g_signal_connect(header_factory, "setup", G_CALLBACK(on_header_setup), NULL);
+    g_signal_connect(header_factory, "bind", G_CALLBACK(on_header_bind), NULL);
+
+    /* GtkNoSelection takes ownership of g_bind_list; keep our own ref for notifications */
+    GtkNoSelection *selection = gtk_no_selection_new(g_object_ref(G_LIST_MODEL(g_bind_list)));
+    GtkWidget *list_view = gtk_list_view_new(GTK_SELECTION_MODEL(selection), factory);
+    gtk_list_view_set_header_factory(GTK_LIST_VIEW(list_view), header_factory);
+    g_object_unref(header_factory);
+
+    GtkWidget *scroll = gtk_scrolled_window_new();
+    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scroll),
+                                   GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+    gtk_widget_set_vexpand(scroll, TRUE);
+    gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scroll), list_view);
+    return scroll;
+}
+
+/* ----- save indicator ----- */
+static void on_save_state(KeybindsSaveState state) {
+    /* every edit so far is on disk: the journal can point at this file */
+    if (state == KEYBINDS_SAVED) journal_sync();
+    if (!g_save_label) return;
+    gtk_widget_set_tooltip_text(g_save_label, NULL);
+
+    switch (state) {
+    case KEYBINDS_SAVED: gtk_label_set_text(GTK_LABEL(g_save_label), "Saved"); break;
+    case KEYBINDS_SAVE_PENDING:
+    case KEYBINDS_SAVING: gtk_label_set_text(GTK_LABEL(g_save_label), "Saving…"); break;
+    case KEYBINDS_SAVE_FAILED: gtk_label_set_text(GTK_LABEL(g_save_label), "Not saved"); break;
+    }
+}
+
+/* ----- undo / redo ----- */
+static void undo_or_redo(gboolean redo) {
+    /* pull in external edits first, so the step is checked against them */
+    keybinds_reload_if_changed();
+
+    const JournalOp *op = NULL;
+    if (redo ? journal_redo(&op) : journal_undo(&op)) {
+        if (op->type == JOURNAL_EDIT) list_row_changed(op->section, op->row);
+        else list_section_changed(op->section, op->row);
+        refresh_conflict_highlights();
+    }
+    update_undo_buttons();
+}
+
+static void on_undo_clicked(GtkButton *button, gpointer user_data) {
+    undo_or_redo(FALSE);
+}
+
+static void on_redo_clicked(GtkButton *button, gpointer user_data) {
+    undo_or_redo(TRUE);
+}
+
+static gboolean on_undo_shortcut(GtkWidget *widget, GVariant *args, gpointer user_data) {
+    undo_or_redo(GPOINTER_TO_INT(user_data));
+    return TRUE;
+}
+
+static GtkWidget *create_toolbar(void) {
+    GtkWidget *hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 8);
+
+    GtkWidget *add_btn = gtk_button_new_with_label("Add keybind");
+    g_signal_connect(add_btn, "clicked", G_CALLBACK((GCallback)(void(*)(GtkButton*,gpointer))((void(*)(void))open_add_dialog)), NULL);
+    gtk_widget_set_hexpand(add_btn, TRUE);
+    gtk_box_append(GTK_BOX(hbox), add_btn);
+
+    g_undo_button = gtk_button_new_with_label("Undo");
+    gtk_widget_set_tooltip_text(g_undo_button, "Undo the last change (Ctrl+Z)");
+    g_signal_connect(g_undo_button, "clicked", G_CALLBACK(on_undo_clicked), NULL);
+    gtk_box_append(GTK_BOX(hbox), g_undo_button);
+
+    g_save_label = gtk_label_new(NULL);
+    gtk_widget_add_css_class(g_save_label, "dim-label");
+    gtk_box_append(GTK_BOX(hbox), g_save_label);
+
+    g_redo_button = gtk_button_new_with_label("Redo");
+    gtk_widget_set_tooltip_text(g_redo_button, "Redo the last undone change (Ctrl+Shift+Z)");
+    g_signal_connect(g_redo_button, "clicked", G_CALLBACK(on_redo_clicked), NULL);
+    gtk_box_append(GTK_BOX(hbox), g_redo_button);
+
+    /* GTK_SHORTCUT_SCOPE_MANAGED: active anywhere in the window, not only
+     * while the tab has focus-within */
+    GtkEventController *shortcuts = gtk_shortcut_controller_new();
+    gtk_shortcut_controller_set_scope(GTK_SHORTCUT_CONTROLLER(shortcuts), GTK_SHORTCUT_SCOPE_MANAGED);
+    gtk_shortcut_controller_add_shortcut(GTK_SHORTCUT_CONTROLLER(shortcuts),
+        gtk_shortcut_new(gtk_shortcut_trigger_parse_string("<Control>z"),
+                         gtk_callback_action_new(on_undo_shortcut, GINT_TO_POINTER(FALSE), NULL)));
+    gtk_shortcut_controller_add_shortcut(GTK_SHORTCUT_CONTROLLER(shortcuts),
+        gtk_shortcut_new(gtk_shortcut_trigger_parse_string("<Control><Shift>z"),
+                         gtk_callback_action_new(on_undo_shortcut, GINT_TO_POINTER(TRUE), NULL)));
+    gtk_widget_add_controller(g_main_box, shortcuts);
+
+    update_undo_buttons();
+    return hbox;
+}
+
 /* ----- rebuild UI ----- */
+/* Builds the list view once; afterwards only resyncs the model, so GTK
+ * realizes widgets for the visible rows only. */
 void rebuild_ui(void) {
     if (!g_main_box) return;
-    clear_box_children(g_main_box);
+    gint64 span = stats_begin();
 
-    GtkWidget *add_btn = gtk_button_new_with_label("Add keybind");
-    g_signal_connect(add_btn, "clicked", G_CALLBACK((GCallback)(void(*)(GtkButton*,gpointer))((void(*)(void))open_add_dialog)), NULL);
-    gtk_box_append(GTK_BOX(g_main_box), add_btn);
+    if (!g_bind_list) {
+        gtk_box_append(GTK_BOX(g_main_box), create_toolbar());
 
-    for (int i = 0; i < g_section_count; ++i) {
-        GtkWidget *header_label = gtk_label_new(NULL);
-        char *markup = g_markup_printf_escaped("<b>%s</b>", g_sections[i].header);
-        gtk_label_set_markup(GTK_LABEL(header_label), markup);
-        g_free(markup);
-        gtk_widget_set_halign(header_label, GTK_ALIGN_START);
-        gtk_box_append(GTK_BOX(g_main_box), header_label);
+        GtkWidget *search = gtk_search_entry_new();
+        gtk_search_entry_set_placeholder_text(GTK_SEARCH_ENTRY(search),
+                                              "Search sections, modifiers, keys, dispatchers, commands");
+        g_signal_connect(search, "search-changed", G_CALLBACK(on_search_changed), NULL);
+        gtk_box_append(GTK_BOX(g_main_box), search);
 
-        GPtrArray *btns = g_sections[i].buttons;
-        for (size_t j = 0; j < btns->len; ++j) {
-            char *btn_label = g_ptr_array_index(btns, j);
+        gtk_box_append(GTK_BOX(g_main_box), create_bind_list_view());
+    } else {
+        kb_bind_list_reset(g_bind_list);
+        apply_search();
+    }
+    stats_end(STATS_REBUILD_UI, span);
+}
 
-            GtkWidget *hrow = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 8);
-            gtk_widget_set_hexpand(hrow, TRUE);
+/* ------------------------- live reload ------------------------ */
+/* Events from one save (write, rename, attribute change...) arrive in
+ * bursts; they are coalesced into one check this long after the last. */
+#define RELOAD_DEBOUNCE_MS 200
+
+static GPtrArray *g_monitors = NULL;  /* GFileMonitor, one per file and per g_include_dirs */
+static guint g_reload_source = 0;
+
+static void watch_files(void);
+
+/* A full reload dropped edits that were not written yet. The history is
+ * moved back to the last save, so Redo puts them back one by one. */
+static void report_lost_edits(void) {
+    gboolean redo = journal_rewind_to_saved() && journal_can_redo();
+    g_printerr("%s changed on disk before the last edits were saved; they were not saved%s\n", g_filepath,
+               redo ? " (Redo re-applies them)" : "");
+    if (!g_save_label) return;
+    gtk_label_set_text(GTK_LABEL(g_save_label), "Edits not saved");
+    gtk_widget_set_tooltip_text(g_save_label, redo ? "The file changed on disk and was reloaded. "
+                                                     "Redo re-applies the edits that were not saved."
+                                                   : "The file changed on disk and was reloaded.");
+}
 
-            GtkWidget *button = gtk_button_new_with_label(btn_label ? btn_label : "");
-            GtkWidget *label = gtk_label_new(NULL);
-            gtk_label_set_selectable(GTK_LABEL(label), TRUE);
+gboolean keybinds_reload_if_changed(void) {
+    GArray *changed = g_array_new(FALSE, FALSE, sizeof(int));
+    gboolean unsaved = keybinds_has_unsaved_edits();
+    KeybindsReload result = keybinds_reload(changed);
+
+    if (result == KEYBINDS_RELOAD_SECTIONS) {
+        if (g_bind_list && kb_bind_list_is_filtered(g_bind_list)) {
+            apply_search();
+        } else if (g_bind_list) {
+            for (guint i = 0; i < changed->len; i++)
+                kb_bind_list_section_changed(g_bind_list, g_array_index(changed, int, i), 0);
+        }
+        refresh_conflict_highlights();
+        g_print("Reloaded %u changed section(s) of %s\n", changed->len, g_filepath);
+    } else if (result == KEYBINDS_RELOAD_FULL) {
+        rebuild_ui();
+        /* includes may have come or gone */
+        watch_files();
+        g_print("Reloaded %s\n", g_filepath);
+    }
 
-            ButtonContext *ctx = g_new0(ButtonContext, 1);
-            ctx->section_index = i;
-            ctx->button_index = j;
-            ctx->sections = g_sections;
-            ctx->section_count = g_section_count;
-            strncpy(ctx->filepath, g_filepath, sizeof(ctx->filepath)-1);
-            ctx->parent_win = g_app_window;
+    /* Only a new layout invalidates the history wholesale. After a partial
+     * reload each undo/redo checks its line is still where it was, and
+     * the history is dropped the first time one is not. */
+    if (result == KEYBINDS_RELOAD_FULL && unsaved) report_lost_edits();
+    else if (result == KEYBINDS_RELOAD_FULL) journal_reset();
+    else if (result == KEYBINDS_RELOAD_FAILED && unsaved) on_save_state(KEYBINDS_SAVE_FAILED);
+    if (result != KEYBINDS_RELOAD_NONE) update_undo_buttons();
 
-            g_object_set_data_full(G_OBJECT(button), "button-ctx", ctx, g_free);
+    g_array_unref(changed);
+    return result != KEYBINDS_RELOAD_NONE;
+}
 
-            g_signal_connect(button, "clicked", G_CALLBACK(on_existing_button_clicked), NULL);
+static gboolean on_reload_timeout(gpointer user_data) {
+    g_reload_source = 0;
+    keybinds_reload_if_changed();
+    return G_SOURCE_REMOVE;
+}
 
-            gtk_box_append(GTK_BOX(hrow), button);
+static void schedule_reload(void) {
+    if (g_reload_source) g_source_remove(g_reload_source);
+    g_reload_source = g_timeout_add(RELOAD_DEBOUNCE_MS, on_reload_timeout, NULL);
+}
 
-            GtkWidget *del_btn = gtk_button_new_with_label("Delete");
-            g_signal_connect(del_btn, "clicked", G_CALLBACK(on_delete_button_clicked), NULL);
-            gtk_box_append(GTK_BOX(hrow), del_btn);
+static void on_keybinds_file_changed(GFileMonitor *monitor, GFile *file, GFile *other_file,
+                                      GFileMonitorEvent event, gpointer user_data) {
+    if (event == G_FILE_MONITOR_EVENT_DELETED || event == G_FILE_MONITOR_EVENT_MOVED_OUT
+        || event == G_FILE_MONITOR_EVENT_PRE_UNMOUNT || event == G_FILE_MONITOR_EVENT_UNMOUNTED)
+        return;
+    schedule_reload();
+}
 
-            gtk_box_append(GTK_BOX(g_main_box), hrow);
-        }
+/* A file came or went where a glob or a missing include points; the
+ * reload sees the directory changed and parses everything again */
+static void on_include_dir_changed(GFileMonitor *monitor, GFile *file, GFile *other_file,
+                                   GFileMonitorEvent event, gpointer user_data) {
+    if (event == G_FILE_MONITOR_EVENT_CREATED || event == G_FILE_MONITOR_EVENT_DELETED
+        || event == G_FILE_MONITOR_EVENT_MOVED_IN || event == G_FILE_MONITOR_EVENT_MOVED_OUT
+        || event == G_FILE_MONITOR_EVENT_RENAMED)
+        schedule_reload();
+}
+
+static void watch(const char *path, gboolean directory, GCallback callback) {
+    GFile *file = g_file_new_for_path(path);
+    GError *error = NULL;
+    GFileMonitor *monitor = directory ? g_file_monitor_directory(file, G_FILE_MONITOR_WATCH_MOVES, NULL, &error)
+                                      : g_file_monitor_file(file, G_FILE_MONITOR_WATCH_MOVES, NULL, &error);
+    g_object_unref(file);
+    if (!monitor) {
+        g_printerr("Failed to watch %s: %s\n", path, error->message);
+        g_clear_error(&error);
+        return;
     }
+    g_signal_connect(monitor, "changed", callback, NULL);
+    g_ptr_array_add(g_monitors, monitor);
+}
+
+/* Watches g_filepath, every file it sources and the directories that
+ * decide which files those are */
+static void watch_files(void) {
+    if (g_monitors) g_ptr_array_set_size(g_monitors, 0);
+    else g_monitors = g_ptr_array_new_with_free_func(g_object_unref);
+
+    for (int i = 0; i < g_file_count; i++) watch(g_files[i].path, FALSE, G_CALLBACK(on_keybinds_file_changed));
+    for (guint i = 0; g_include_dirs && i < g_include_dirs->len; i++)
+        watch(g_ptr_array_index(g_include_dirs, i), TRUE, G_CALLBACK(on_include_dir_changed));
+}
+
+void keybinds_watch(void) {
+    if (g_monitors) return;
+    keybinds_set_external_edit_handler(schedule_reload);
+    keybinds_set_save_state_handler(on_save_state);
+    watch_files();
 }
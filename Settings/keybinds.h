@@ -3,32 +3,21 @@
 
 #include <gtk/gtk.h>
 #include <glib.h>
-
-#define MAX_LINE_LENGTH 512
-
-typedef struct Section {
-    char header[128];
-    GPtrArray *buttons;
-} Section;
+#include "keybinds_model.h"
 
 typedef struct {
     int section_index;
     int button_index;
-    Section *sections;
-    int section_count;
-    char filepath[512];
-    GtkWidget *parent_win;
 } ButtonContext;
 
-extern Section *g_sections;
-extern int g_section_count;
-extern char g_filepath[512];
-extern GPtrArray *preamble_lines;
 extern GtkWidget *g_main_box;
 extern GtkWidget *g_app_window;
 
-Section *parse_keybinds(const char *filepath, int *out_section_count);
-void rewrite_config(const char *filepath, Section *sections, int section_count);
+/* Live reload: watch g_filepath and the files it sources, and merge
+ * external edits into the model and the list, re-parsing only the sections
+ * whose content changed */
+void keybinds_watch(void);
+gboolean keybinds_reload_if_changed(void);
 void rebuild_ui(void);
 void open_add_dialog(void);
 void on_existing_button_clicked(GtkButton *button, gpointer user_data);
@@ -0,0 +1,289 @@
+#include "keybinds_batch.h"
+#include "keybinds_model.h"
+#include "keybind_conflicts.h"
+#include <json-glib/json-glib.h>
+#include <gio/gio.h>
+#include <string.h>
+
+/* A line of the model; rows never move during a batch because removals
+ * are only marked, and carried out once every edit has been applied */
+#define REF(section, row) (((guint64)(section) << 32) | (row))
+#define REF_SECTION(ref) ((int)((ref) >> 32))
+#define REF_ROW(ref) ((guint)((ref) & 0xffffffffu))
+
+typedef struct {
+    GHashTable *sections; /* header -> index + 1 */
+    GHashTable *by_text;  /* line text -> GArray of refs */
+    GHashTable *by_chord; /* &chord -> GArray of refs */
+    GHashTable *removed;  /* &ref, marked for removal */
+} Batch;
+
+/* ------------------------- index ------------------------ */
+/* Modifiers and key, whatever the trigger flags: "SUPER, T" finds bindel too */
+static gboolean chord_of(const Keybind *kb, guint64 *out) {
+    if (!keybind_is_bind(kb) || kb->key == 0) return FALSE;
+    *out = ((guint64)kb->key << 16) | kb->mods;
+    return TRUE;
+}
+
+/* key_size > 0: the table owns its keys, copy key on first use */
+static void refs_add(GHashTable *table, gconstpointer key, gsize key_size, guint64 ref) {
+    GArray *refs = g_hash_table_lookup(table, key);
+    if (!refs) {
+        refs = g_array_new(FALSE, FALSE, sizeof(guint64));
+        g_hash_table_insert(table, key_size ? g_memdup2(key, key_size) : (gpointer)key, refs);
+    }
+    g_array_append_val(refs, ref);
+}
+
+static void refs_remove(GHashTable *table, gconstpointer key, guint64 ref) {
+    GArray *refs = g_hash_table_lookup(table, key);
+    for (guint i = 0; refs && i < refs->len; i++) {
+        if (g_array_index(refs, guint64, i) != ref) continue;
+        g_array_remove_index_fast(refs, i);
+        return;
+    }
+}
+
+static Keybind *kb_at(guint64 ref) {
+    return &g_array_index(g_sections[REF_SECTION(ref)].binds, Keybind, REF_ROW(ref));
+}
+
+static void index_line(Batch *b, guint64 ref) {
+    const Keybind *kb = kb_at(ref);
+    refs_add(b->by_text, kb->text, 0, ref);
+    guint64 chord;
+    if (chord_of(kb, &chord)) refs_add(b->by_chord, &chord, sizeof(chord), ref);
+}
+
+static void unindex_line(Batch *b, guint64 ref) {
+    const Keybind *kb = kb_at(ref);
+    refs_remove(b->by_text, kb->text, ref);
+    guint64 chord;
+    if (chord_of(kb, &chord)) refs_remove(b->by_chord, &chord, ref);
+}
+
+static void batch_init(Batch *b) {
+    b->sections = g_hash_table_new(g_str_hash, g_str_equal);
+    b->by_text = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)g_array_unref);
+    b->by_chord = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, (GDestroyNotify)g_array_unref);
+    b->removed = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, NULL);
+
+    for (int i = 0; i < g_section_count; i++) {
+        g_hash_table_insert(b->sections, (gpointer)g_sections[i].header, GINT_TO_POINTER(i + 1));
+        for (guint j = 0; j < g_sections[i].binds->len; j++) index_line(b, REF(i, j));
+    }
+}
+
+static void batch_clear(Batch *b) {
+    g_hash_table_unref(b->sections);
+    g_hash_table_unref(b->by_text);
+    g_hash_table_unref(b->by_chord);
+    g_hash_table_unref(b->removed);
+}
+
+/* ------------------------- edits ------------------------ */
+static int find_section(Batch *b, const char *header) {
+    return GPOINTER_TO_INT(g_hash_table_lookup(b->sections, header)) - 1;
+}
+
+/* Live lines matching match, restricted to section unless it is -1 */
+static GArray *find_matches(Batch *b, const char *match, int section) {
+    Keybind probe;
+    keybind_parse(&probe, match);
+
+    GArray *found = NULL;
+    if (keybind_is_bind(&probe)) {
+        found = g_hash_table_lookup(b->by_text, match);
+    } else {
+        char *line = g_strconcat("bind = ", match, NULL);
+        guint64 chord;
+        keybind_parse(&probe, line);
+        if (chord_of(&probe, &chord)) found = g_hash_table_lookup(b->by_chord, &chord);
+        g_free(line);
+    }
+
+    GArray *out = g_array_new(FALSE, FALSE, sizeof(guint64));
+    for (guint i = 0; found && i < found->len; i++) {
+        guint64 ref = g_array_index(found, guint64, i);
+        if (section < 0 || REF_SECTION(ref) == section) g_array_append_val(out, ref);
+    }
+    return out;
+}
+
+static gboolean valid_bind(const char *line, GError **error) {
+    Keybind kb;
+    keybind_parse(&kb, line);
+    if (strchr(line, '\n') || !keybind_is_bind(&kb)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "\"%s\" is not a bind line", line);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean apply_add(Batch *b, JsonObject *edit, BatchCounts *counts, GError **error) {
+    const char *header = json_object_get_string_member_with_default(edit, "section", NULL);
+    const char *line = json_object_get_string_member_with_default(edit, "bind", NULL);
+    if (!header || !line) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "add needs \"section\" and \"bind\"");
+        return FALSE;
+    }
+    char *text = g_strstrip(g_strdup(line));
+    gboolean ok = valid_bind(text, error);
+    if (ok && strchr(header, '\n')) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "bad section name \"%s\"", header);
+        ok = FALSE;
+    }
+    if (ok) {
+        int section = find_section(b, header);
+        if (section < 0) {
+            section = model_append_section(header);
+            g_hash_table_insert(b->sections, (gpointer)g_sections[section].header,
+                                GINT_TO_POINTER(section + 1));
+        }
+        guint64 ref = REF(section, model_append_bind(section, text));
+        index_line(b, ref);
+        if (conflicts_count(kb_at(ref)) > 1)
+            g_printerr("Warning: %s shares its key combination with another bind\n", text);
+        counts->added++;
+    }
+    g_free(text);
+    return ok;
+}
+
+/* remove and replace: resolve "match" to the lines they act on */
+static GArray *resolve_match(Batch *b, JsonObject *edit, GError **error) {
+    const char *match = json_object_get_string_member_with_default(edit, "match", NULL);
+    const char *header = json_object_get_string_member_with_default(edit, "section", NULL);
+    gboolean all = json_object_get_boolean_member_with_default(edit, "all", FALSE);
+    if (!match) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "missing \"match\"");
+        return NULL;
+    }
+
+    int section = -1;
+    if (header && (section = find_section(b, header)) < 0) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "no section \"%s\"", header);
+        return NULL;
+    }
+
+    char *text = g_strstrip(g_strdup(match));
+    GArray *refs = find_matches(b, text, section);
+    g_free(text);
+    if (refs->len == 0 || (refs->len > 1 && !all)) {
+        if (refs->len == 0) g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "nothing matches \"%s\"", match);
+        else g_set_error(error, G_IO_ERROR, G_IO_ERROR_EXISTS,
+                         "\"%s\" matches %u lines; add \"all\": true to edit them all", match, refs->len);
+        g_array_unref(refs);
+        return NULL;
+    }
+    return refs;
+}
+
+static gboolean apply_remove(Batch *b, JsonObject *edit, BatchCounts *counts, GError **error) {
+    GArray *refs = resolve_match(b, edit, error);
+    if (!refs) return FALSE;
+
+    for (guint i = 0; i < refs->len; i++) {
+        guint64 ref = g_array_index(refs, guint64, i);
+        unindex_line(b, ref);
+        g_hash_table_add(b->removed, g_memdup2(&ref, sizeof(ref)));
+        counts->removed++;
+    }
+    g_array_unref(refs);
+    return TRUE;
+}
+
+static gboolean apply_replace(Batch *b, JsonObject *edit, BatchCounts *counts, GError **error) {
+    const char *line = json_object_get_string_member_with_default(edit, "bind", NULL);
+    if (!line) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "replace needs \"bind\"");
+        return FALSE;
+    }
+    GArray *refs = resolve_match(b, edit, error);
+    if (!refs) return FALSE;
+
+    char *text = g_strstrip(g_strdup(line));
+    gboolean ok = valid_bind(text, error);
+    for (guint i = 0; ok && i < refs->len; i++) {
+        guint64 ref = g_array_index(refs, guint64, i);
+        unindex_line(b, ref);
+        model_replace_bind(REF_SECTION(ref), REF_ROW(ref), text);
+        index_line(b, ref);
+        counts->replaced++;
+    }
+    g_free(text);
+    g_array_unref(refs);
+    return ok;
+}
+
+static gint compare_refs_descending(gconstpointer a, gconstpointer b) {
+    guint64 x = *(const guint64 *)a, y = *(const guint64 *)b;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+/* Drop the marked lines, last row first so the others stay put */
+static void commit_removals(Batch *b) {
+    GArray *refs = g_array_sized_new(FALSE, FALSE, sizeof(guint64), g_hash_table_size(b->removed));
+    GHashTableIter iter;
+    gpointer key;
+    g_hash_table_iter_init(&iter, b->removed);
+    while (g_hash_table_iter_next(&iter, &key, NULL)) g_array_append_val(refs, *(guint64 *)key);
+    g_array_sort(refs, compare_refs_descending);
+
+    for (guint i = 0; i < refs->len; i++) {
+        guint64 ref = g_array_index(refs, guint64, i);
+        model_remove_bind(REF_SECTION(ref), REF_ROW(ref));
+    }
+    g_array_unref(refs);
+}
+
+/* ------------------------- public ------------------------ */
+gboolean keybinds_apply_batch(const char *json, gssize length, BatchCounts *counts, GError **error) {
+    memset(counts, 0, sizeof(*counts));
+
+    JsonParser *parser = json_parser_new();
+    if (!json_parser_load_from_data(parser, json, length, error)) {
+        g_object_unref(parser);
+        return FALSE;
+    }
+
+    JsonNode *root = json_parser_get_root(parser);
+    JsonArray *edits = NULL;
+    if (root && JSON_NODE_HOLDS_ARRAY(root)) {
+        edits = json_node_get_array(root);
+    } else if (root && JSON_NODE_HOLDS_OBJECT(root)
+               && json_object_has_member(json_node_get_object(root), "edits")) {
+        edits = json_object_get_array_member(json_node_get_object(root), "edits");
+    }
+    if (!edits) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                            "expected an array of edits or an object with \"edits\"");
+        g_object_unref(parser);
+        return FALSE;
+    }
+
+    Batch b;
+    batch_init(&b);
+    gboolean ok = TRUE;
+    guint n = json_array_get_length(edits);
+    for (guint i = 0; ok && i < n; i++) {
+        JsonNode *node = json_array_get_element(edits, i);
+        JsonObject *edit = JSON_NODE_HOLDS_OBJECT(node) ? json_node_get_object(node) : NULL;
+        const char *op = edit ? json_object_get_string_member_with_default(edit, "op", "") : "";
+
+        if (strcmp(op, "add") == 0) ok = apply_add(&b, edit, counts, error);
+        else if (strcmp(op, "remove") == 0) ok = apply_remove(&b, edit, counts, error);
+        else if (strcmp(op, "replace") == 0) ok = apply_replace(&b, edit, counts, error);
+        else {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "unknown op \"%s\"", op);
+            ok = FALSE;
+        }
+        if (!ok) g_prefix_error(error, "edit %u: ", i + 1);
+    }
+
+    if (ok) commit_removals(&b);
+    batch_clear(&b);
+    g_object_unref(parser);
+    return ok;
+}
@@ -0,0 +1,29 @@
+#ifndef KEYBINDS_BATCH_H
+#define KEYBINDS_BATCH_H
+
+#include <glib.h>
+
+/* Edits to the loaded model (g_sections), as JSON: an array of edits, or
+ * an object with an "edits" array.
+ *
+ *   { "op": "add",     "section": "Apps", "bind": "bind = $mainMod, T, exec, kitty" }
+ *   { "op": "remove",  "match": "$mainMod, T" }
+ *   { "op": "replace", "match": "bind = $mainMod, T, exec, kitty",
+ *                      "bind": "bind = $mainMod, T, exec, foot" }
+ *
+ * "match" is either a whole bind line, compared exactly, or "MODS, KEY", which
+ * matches every bind on that chord. It must match exactly one line unless
+ * "all": true is given; "section" restricts it to one section. add creates
+ * a missing section at the end of the file. */
+typedef struct {
+    guint added;
+    guint removed;
+    guint replaced;
+} BatchCounts;
+
+/* Validates and applies every edit in memory; nothing is written. Stops at
+ * the first invalid edit with an error naming it, in which case the model
+ * is partly edited and must not be written. */
+gboolean keybinds_apply_batch(const char *json, gssize length, BatchCounts *counts, GError **error);
+
+#endif // KEYBINDS_BATCH_H
@@ -0,0 +1,459 @@
+#include "keybinds_cache.h"
+#include "keybind_conflicts.h"
+#include "keybind_search.h"
+#include "stats.h"
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Native byte order and field sizes: the cache never leaves the machine
+ * that wrote it, the header just makes sure of that. Bump CACHE_VERSION
+ * when the layout below changes. What the parser produces is covered by
+ * the build identity: KEYBINDS_PARSER_ID is a hash of the parser, index
+ * and cache sources (CMakeLists.txt), so a snapshot written by another
+ * build is never trusted. */
+#define CACHE_MAGIC "kbcache"
+#define CACHE_VERSION 2
+#define CACHE_BYTE_ORDER 0x01020304u
+#define NO_STRING G_MAXUINT32
+
+#ifndef KEYBINDS_PARSER_ID
+#define KEYBINDS_PARSER_ID "unknown"
+#endif
+
+static guint64 build_id(void) {
+    char id[256];
+    int len = snprintf(id, sizeof(id), "%s/%d/%zu/%zu/%zu", KEYBINDS_PARSER_ID, CACHE_VERSION, sizeof(Keybind),
+                       sizeof(Section), sizeof(GQuark));
+    return keybinds_hash(id, MIN(len, (int)sizeof(id) - 1));
+}
+
+static char *cache_path(const char *filepath) {
+    char name[64];
+    snprintf(name, sizeof(name), "keybinds-%016" G_GINT64_MODIFIER "x.cache",
+             keybinds_hash(filepath, strlen(filepath)));
+    return g_build_filename(g_get_user_cache_dir(), "settings-app", name, NULL);
+}
+
+static gint64 mtime_ns(const char *path) {
+    GStatBuf st;
+    if (g_stat(path, &st) != 0) return -1;
+    return (gint64)st.st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) + st.st_mtim.tv_nsec;
+}
+
+/* ------------------------- writing ------------------------ */
+static void put(GByteArray *out, const void *data, gsize len) {
+    g_byte_array_append(out, data, len);
+}
+
+static void put_u32(GByteArray *out, guint32 v) {
+    put(out, &v, sizeof(v));
+}
+
+static void put_u64(GByteArray *out, guint64 v) {
+    put(out, &v, sizeof(v));
+}
+
+static void put_str(GByteArray *out, const char *s) {
+    if (!s) {
+        put_u32(out, NO_STRING);
+        return;
+    }
+    guint32 len = strlen(s);
+    put_u32(out, len);
+    put(out, s, len);
+}
+
+static void count_variable(gpointer name, gpointer value, gpointer user_data) {
+    (*(guint32 *)user_data)++;
+}
+
+static void put_variable(gpointer name, gpointer value, gpointer user_data) {
+    put_str(user_data, name);
+    put_str(user_data, value);
+}
+
+/* Index+1 of quark in the string table, 0 for none */
+static guint32 string_index(GHashTable *table, GPtrArray *strings, GQuark quark) {
+    if (!quark) return 0;
+    gpointer index;
+    if (g_hash_table_lookup_extended(table, GUINT_TO_POINTER(quark), NULL, &index))
+        return GPOINTER_TO_UINT(index);
+    g_ptr_array_add(strings, (gpointer)g_quark_to_string(quark));
+    g_hash_table_insert(table, GUINT_TO_POINTER(quark), GUINT_TO_POINTER(strings->len));
+    return strings->len;
+}
+
+void keybinds_cache_save(const char *filepath, Section *sections, int section_count) {
+    GByteArray *out = g_byte_array_sized_new(64 * 1024);
+    put(out, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    put_u32(out, CACHE_VERSION);
+    put_u32(out, CACHE_BYTE_ORDER);
+    put_u64(out, build_id());
+
+    put_u32(out, g_file_count);
+    for (int i = 0; i < g_file_count; i++) {
+        const ConfigFile *f = &g_files[i];
+        put_str(out, f->path);
+        put_u64(out, f->disk.mtime_ns);
+        put_u64(out, f->disk.size);
+        put_u64(out, f->disk.hash);
+        put_u64(out, f->disk.layout_hash);
+        put_u32(out, f->parent);
+        put_u32(out, f->source_line);
+        put_u32(out, f->preamble ? f->preamble->len : 0);
+        for (guint j = 0; f->preamble && j < f->preamble->len; j++)
+            put_str(out, g_ptr_array_index(f->preamble, j));
+    }
+
+    put_u32(out, g_include_dirs ? g_include_dirs->len : 0);
+    for (guint i = 0; g_include_dirs && i < g_include_dirs->len; i++) {
+        const char *dir = g_ptr_array_index(g_include_dirs, i);
+        put_str(out, dir);
+        put_u64(out, mtime_ns(dir));
+    }
+
+    guint32 n_variables = 0;
+    keybind_foreach_variable(count_variable, &n_variables);
+    put_u32(out, n_variables);
+    keybind_foreach_variable(put_variable, out);
+
+    /* keys and dispatchers are quarks, which only mean something in this
+     * process: they go out as an index into a table of their names */
+    GHashTable *table = g_hash_table_new(g_direct_hash, g_direct_equal);
+    GPtrArray *strings = g_ptr_array_new();
+    for (int i = 0; i < section_count; i++) {
+        GArray *binds = sections[i].binds;
+        for (guint j = 0; j < binds->len; j++) {
+            const Keybind *kb = &g_array_index(binds, Keybind, j);
+            string_index(table, strings, kb->key);
+            string_index(table, strings, kb->dispatcher);
+        }
+    }
+    put_u32(out, strings->len);
+    for (guint i = 0; i < strings->len; i++) put_str(out, g_ptr_array_index(strings, i));
+
+    put_u32(out, section_count);
+    for (int i = 0; i < section_count; i++) {
+        const Section *s = &sections[i];
+        put_str(out, s->header);
+        put_u64(out, s->hash);
+        put_u32(out, s->file);
+        put_u32(out, s->binds->len);
+        for (guint j = 0; j < s->binds->len; j++) {
+            const Keybind *kb = &g_array_index(s->binds, Keybind, j);
+            put_str(out, kb->text);
+            put_u32(out, string_index(table, strings, kb->key));
+            put_u32(out, string_index(table, strings, kb->dispatcher));
+            put_u32(out, kb->args_off);
+            put_u32(out, kb->args_len);
+            put_u32(out, kb->id);
+            put_u32(out, kb->line);
+            put_u32(out, ((guint32)kb->flags << 16) | kb->mods);
+        }
+    }
+    g_hash_table_destroy(table);
+    g_ptr_array_unref(strings);
+
+    GByteArray *index = g_byte_array_new();
+    search_save(index);
+    put_u32(out, index->len);
+    put(out, index->data, index->len);
+    g_byte_array_unref(index);
+
+    put_u64(out, keybinds_hash((const char *)out->data, out->len));
+
+    char *path = cache_path(filepath);
+    char *dir = g_path_get_dirname(path);
+    GError *error = NULL;
+    g_mkdir_with_parents(dir, 0755);
+    if (!g_file_set_contents(path, (const char *)out->data, out->len, &error)) {
+        g_printerr("Failed to write %s: %s\n", path, error->message);
+        g_clear_error(&error);
+    }
+    g_free(dir);
+    g_free(path);
+    g_byte_array_unref(out);
+}
+
+/* ------------------------- reading ------------------------ */
+/* Every read is bounds checked; the first one out of bounds clears ok and
+ * makes all later ones return zeroes */
+typedef struct {
+    const guint8 *p;
+    const guint8 *end;
+    gboolean ok;
+} Reader;
+
+static gboolean get(Reader *r, void *out, gsize len) {
+    if (!r->ok || (gsize)(r->end - r->p) < len) {
+        r->ok = FALSE;
+        memset(out, 0, len);
+        return FALSE;
+    }
+    memcpy(out, r->p, len);
+    r->p += len;
+    return TRUE;
+}
+
+static guint32 get_u32(Reader *r) {
+    guint32 v;
+    get(r, &v, sizeof(v));
+    return v;
+}
+
+static guint64 get_u64(Reader *r) {
+    guint64 v;
+    get(r, &v, sizeof(v));
+    return v;
+}
+
+/* Points into the mapping, not NUL-terminated; NULL with *len 0 for a
+ * NULL string */
+static const char *get_str(Reader *r, guint32 *len) {
+    *len = get_u32(r);
+    if (*len == NO_STRING) {
+        *len = 0;
+        return NULL;
+    }
+    if (!r->ok || (gsize)(r->end - r->p) < *len) {
+        r->ok = FALSE;
+        *len = 0;
+        return NULL;
+    }
+    const char *s = (const char *)r->p;
+    r->p += *len;
+    return s;
+}
+
+static char *get_path(Reader *r) {
+    guint32 len;
+    const char *s = get_str(r, &len);
+    return s ? g_strndup(s, len) : NULL;
+}
+
+/* Same bytes as when the snapshot was taken */
+static gboolean file_unchanged(const char *path, gint64 mtime, gint64 size, guint64 hash) {
+    GStatBuf st;
+    if (g_stat(path, &st) != 0 || st.st_size != size
+        || (gint64)st.st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) + st.st_mtim.tv_nsec != mtime)
+        return FALSE;
+
+    GMappedFile *mapped = g_mapped_file_new(path, FALSE, NULL);
+    if (!mapped) return FALSE;
+    gboolean same = keybinds_hash(g_mapped_file_get_contents(mapped), g_mapped_file_get_length(mapped)) == hash;
+    g_mapped_file_unref(mapped);
+    return same;
+}
+
+static void free_files(ConfigFile *files, int count) {
+    for (int i = 0; i < count; i++) {
+        g_free(files[i].path);
+        if (files[i].preamble) g_ptr_array_free(files[i].preamble, TRUE);
+        if (files[i].arena) g_string_chunk_free(files[i].arena);
+    }
+    g_free(files);
+}
+
+static void free_sections(Section *sections, int count) {
+    for (int i = 0; i < count; i++) g_array_free(sections[i].binds, TRUE);
+    free(sections);
+}
+
+/* Files and include directories, each checked against the disk as it is
+ * read; FALSE on the first one that changed */
+static gboolean read_files(Reader *r, ConfigFile **out_files, int *out_count, GPtrArray **out_dirs) {
+    guint32 n_files = get_u32(r);
+    if (!r->ok || n_files == 0 || n_files > (guint32)(r->end - r->p)) return FALSE;
+    ConfigFile *files = g_new0(ConfigFile, n_files);
+    gboolean ok = TRUE;
+    guint32 read = 0;
+
+    for (; read < n_files && ok; read++) {
+        ConfigFile *f = &files[read];
+        f->path = get_path(r);
+        f->disk.mtime_ns = get_u64(r);
+        f->disk.size = get_u64(r);
+        f->disk.hash = get_u64(r);
+        f->disk.layout_hash = get_u64(r);
+        f->parent = (gint32)get_u32(r);
+        f->source_line = get_u32(r);
+        ok = r->ok && f->path && f->parent < (gint32)n_files
+             && file_unchanged(f->path, f->disk.mtime_ns, f->disk.size, f->disk.hash);
+        if (!ok) break;
+
+        guint32 n_preamble = get_u32(r);
+        f->arena = g_string_chunk_new(MAX(4096, (gsize)f->disk.size));
+        f->preamble = g_ptr_array_new();
+        for (guint32 j = 0; j < n_preamble && r->ok; j++) {
+            guint32 len;
+            const char *line = get_str(r, &len);
+            g_ptr_array_add(f->preamble, g_string_chunk_insert_len(f->arena, line ? line : "", len));
+        }
+        ok = r->ok;
+    }
+
+    GPtrArray *dirs = g_ptr_array_new_with_free_func(g_free);
+    guint32 n_dirs = ok ? get_u32(r) : 0;
+    for (guint32 i = 0; i < n_dirs && ok; i++) {
+        char *dir = get_path(r);
+        gint64 mtime = get_u64(r);
+        ok = r->ok && dir && mtime_ns(dir) == mtime;
+        if (dir) g_ptr_array_add(dirs, dir);
+    }
+
+    if (!ok) {
+        free_files(files, n_files);
+        g_ptr_array_unref(dirs);
+        return FALSE;
+    }
+    *out_files = files;
+    *out_count = n_files;
+    *out_dirs = dirs;
+    return TRUE;
+}
+
+static GQuark get_quark(Reader *r, GQuark *quarks, guint32 n_quarks) {
+    guint32 index = get_u32(r);
+    if (index > n_quarks) {
+        r->ok = FALSE;
+        return 0;
+    }
+    return index ? quarks[index - 1] : 0;
+}
+
+static Section *read_sections(Reader *r, const ConfigFile *files, int file_count, GQuark *quarks,
+                              guint32 n_quarks, int *out_count) {
+    guint32 n_sections = get_u32(r);
+    if (!r->ok || n_sections > (guint32)(r->end - r->p)) return NULL;
+    Section *sections = malloc(MAX(n_sections, 1) * sizeof(Section));
+    guint32 count = 0;
+
+    for (; count < n_sections && r->ok; count++) {
+        Section *s = &sections[count];
+        guint32 len;
+        const char *header = get_str(r, &len);
+        s->hash = get_u64(r);
+        s->file = (int)get_u32(r);
+        s->dirty = FALSE;
+        s->binds = g_array_new(FALSE, FALSE, sizeof(Keybind));
+        if (!r->ok || !header || s->file < 0 || s->file >= file_count) {
+            r->ok = FALSE;
+            count++;
+            break;
+        }
+        GStringChunk *arena = files[s->file].arena;
+        s->header = g_string_chunk_insert_len(arena, header, len);
+
+        guint32 n_binds = get_u32(r);
+        for (guint32 j = 0; j < n_binds && r->ok; j++) {
+            Keybind kb;
+            const char *text = get_str(r, &len);
+            kb.text = text ? g_string_chunk_insert_len(arena, text, len) : NULL;
+            kb.key = get_quark(r, quarks, n_quarks);
+            kb.dispatcher = get_quark(r, quarks, n_quarks);
+            kb.args_off = get_u32(r);
+            kb.args_len = get_u32(r);
+            kb.id = get_u32(r);
+            kb.line = get_u32(r);
+            guint32 flags_mods = get_u32(r);
+            kb.flags = flags_mods >> 16;
+            kb.mods = flags_mods & 0xffff;
+            if ((guint64)kb.args_off + kb.args_len > len) r->ok = FALSE;
+            g_array_append_val(s->binds, kb);
+        }
+    }
+
+    if (!r->ok) {
+        free_sections(sections, count);
+        return NULL;
+    }
+    *out_count = count;
+    return sections;
+}
+
+static Section *load_mapped(const guint8 *data, gsize len, int *out_section_count) {
+    guint64 checksum;
+    if (len < sizeof(CACHE_MAGIC) + 2 * sizeof(guint32) + sizeof(guint64) + sizeof(checksum)) return NULL;
+    memcpy(&checksum, data + len - sizeof(checksum), sizeof(checksum));
+    if (keybinds_hash((const char *)data, len - sizeof(checksum)) != checksum) return NULL;
+
+    Reader r = { data, data + len - sizeof(checksum), TRUE };
+    char magic[sizeof(CACHE_MAGIC)];
+    get(&r, magic, sizeof(magic));
+    if (memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || get_u32(&r) != CACHE_VERSION
+        || get_u32(&r) != CACHE_BYTE_ORDER || get_u64(&r) != build_id())
+        return NULL;
+
+    ConfigFile *files;
+    int file_count;
+    GPtrArray *dirs;
+    if (!read_files(&r, &files, &file_count, &dirs)) return NULL;
+
+    /* skipped for now, installed once the snapshot is known to be whole */
+    guint32 n_variables = get_u32(&r);
+    Reader variables = r;
+    guint32 skip;
+    for (guint32 i = 0; i < n_variables && r.ok; i++) {
+        get_str(&r, &skip);
+        get_str(&r, &skip);
+    }
+
+    guint32 n_quarks = r.ok ? get_u32(&r) : 0;
+    if (n_quarks > (guint32)(r.end - r.p)) r.ok = FALSE;
+    GQuark *quarks = g_new0(GQuark, r.ok ? n_quarks : 0);
+    for (guint32 i = 0; i < n_quarks && r.ok; i++) {
+        guint32 slen;
+        const char *s = get_str(&r, &slen);
+        char *name = g_strndup(s ? s : "", slen);
+        quarks[i] = g_quark_from_string(name);
+        g_free(name);
+    }
+
+    int section_count = 0;
+    Section *sections = r.ok ? read_sections(&r, files, file_count, quarks, n_quarks, &section_count) : NULL;
+    g_free(quarks);
+    guint32 index_len;
+    const char *index = sections ? get_str(&r, &index_len) : NULL;
+
+    if (!sections || !index || r.p != r.end) {
+        if (sections) free_sections(sections, section_count);
+        free_files(files, file_count);
+        g_ptr_array_unref(dirs);
+        return NULL;
+    }
+
+    /* it checks out: replace the model */
+    free_keybinds();
+    keybind_clear_variables();
+    for (guint32 i = 0; i < n_variables; i++) {
+        guint32 name_len, value_len;
+        const char *name = get_str(&variables, &name_len);
+        const char *value = get_str(&variables, &value_len);
+        if (name && value) keybind_set_variable(name, name_len, value, value_len);
+    }
+
+    g_files = files;
+    g_file_count = file_count;
+    if (dirs->len) g_include_dirs = dirs;
+    else g_ptr_array_unref(dirs);
+    gboolean indexed = search_load((const guint8 *)index, index_len);
+    keybinds_index(sections, section_count, !indexed);
+
+    *out_section_count = section_count;
+    return sections;
+}
+
+Section *keybinds_cache_load(const char *filepath, int *out_section_count) {
+    gint64 span = stats_begin();
+    char *path = cache_path(filepath);
+    GMappedFile *mapped = g_mapped_file_new(path, FALSE, NULL);
+    g_free(path);
+    if (!mapped) return NULL;
+
+    Section *sections = load_mapped((const guint8 *)g_mapped_file_get_contents(mapped),
+                                    g_mapped_file_get_length(mapped), out_section_count);
+    g_mapped_file_unref(mapped);
+    if (sections) stats_end(STATS_CACHE_LOAD, span);
+    return sections;
+}
@@ -0,0 +1,20 @@
+#ifndef KEYBINDS_CACHE_H
+#define KEYBINDS_CACHE_H
+
+#include "keybinds_model.h"
+
+/* A binary snapshot of the parsed model in ~/.cache/settings-app/, one per
+ * config path: every file's stamp and preamble, the variables, the
+ * interned key/dispatcher names, the sections with their binds already
+ * split into fields, and the search index. A launch whose files all still
+ * match their mtime, size and hash (and whose globbed directories did not
+ * change) maps it instead of parsing. */
+
+/* Installs the snapshot as the model, like parse_keybinds(filepath) would;
+ * NULL when there is none, it is stale or it does not check out */
+Section *keybinds_cache_load(const char *filepath, int *out_section_count);
+
+/* Snapshots a model just read from disk; failures are only reported */
+void keybinds_cache_save(const char *filepath, Section *sections, int section_count);
+
+#endif // KEYBINDS_CACHE_H
@@ -0,0 +1,282 @@
+#include "keybinds_journal.h"
+#include "keybinds_model.h"
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+
+#define JOURNAL_HEADER "# keybinds journal v1\n"
+#define JOURNAL_SUFFIX ".journal"
+#define MAX_HISTORY 500
+#define NO_CURSOR G_MAXUINT
+
+/* Records, tab separated, the last field the hash of the config after it:
+ *   do   <a|d|e> <section> <row> <old text> <new text> <hash>
+ *   undo <hash>
+ *   redo <hash>
+ * Texts are g_strescape()d. Replaying them rebuilds ops and the cursor. */
+static GPtrArray *g_ops = NULL;  /* JournalOp, oldest first */
+static guint g_cursor = 0;       /* ops before it are applied */
+static guint g_saved_cursor = 0; /* g_cursor as of the last save; NO_CURSOR once its op is gone */
+static guint g_records = 0;      /* lines in the file, to know when to compact */
+static GPtrArray *g_unsynced = NULL; /* records waiting for the config to be saved */
+static char *g_journal_path = NULL;
+
+static const char op_codes[] = { [JOURNAL_ADD] = 'a', [JOURNAL_DELETE] = 'd', [JOURNAL_EDIT] = 'e' };
+
+static void journal_op_free(gpointer data) {
+    JournalOp *op = data;
+    g_free(op->old_text);
+    g_free(op->new_text);
+    g_free(op);
+}
+
+static JournalOp *journal_op_new(JournalOpType type, int section, guint row, const char *old_text,
+                                 const char *new_text) {
+    JournalOp *op = g_new0(JournalOp, 1);
+    op->type = type;
+    op->section = section;
+    op->row = row;
+    op->old_text = g_strdup(old_text);
+    op->new_text = g_strdup(new_text);
+    return op;
+}
+
+/* A new edit discards whatever could have been redone */
+static void push_op(JournalOp *op) {
+    if (g_saved_cursor != NO_CURSOR && g_saved_cursor > g_cursor) g_saved_cursor = NO_CURSOR;
+    g_ptr_array_set_size(g_ops, g_cursor);
+    g_ptr_array_add(g_ops, op);
+    if (g_ops->len > MAX_HISTORY) {
+        g_ptr_array_remove_index(g_ops, 0);
+        if (g_saved_cursor != NO_CURSOR) g_saved_cursor = g_saved_cursor > 0 ? g_saved_cursor - 1 : NO_CURSOR;
+    }
+    g_cursor = g_ops->len;
+}
+
+/* ------------------------- file ------------------------ */
+/* Without the trailing hash, which is only known once the config is saved */
+static char *do_record(const JournalOp *op) {
+    char *old_text = g_strescape(op->old_text ? op->old_text : "", NULL);
+    char *new_text = g_strescape(op->new_text ? op->new_text : "", NULL);
+    char *record = g_strdup_printf("do\t%c\t%d\t%u\t%s\t%s", op_codes[op->type], op->section,
+                                   op->row, old_text, new_text);
+    g_free(new_text);
+    g_free(old_text);
+    return record;
+}
+
+static char *current_hash(void) {
+    return g_strdup_printf("%016" G_GINT64_MODIFIER "x", keybinds_disk_hash());
+}
+
+/* Rewrite the file as just the live history; only the last hash matters */
+static void compact(void) {
+    GString *out = g_string_new(JOURNAL_HEADER);
+    char *hash = current_hash();
+    for (guint i = 0; i < g_ops->len; i++) {
+        char *record = do_record(g_ptr_array_index(g_ops, i));
+        g_string_append_printf(out, "%s\t%s\n", record, i + 1 == g_ops->len && g_cursor == g_ops->len ? hash : "-");
+        g_free(record);
+    }
+    for (guint i = g_cursor; i < g_ops->len; i++) g_string_append_printf(out, "undo\t%s\n", hash);
+
+    GError *error = NULL;
+    if (!g_file_set_contents(g_journal_path, out->str, out->len, &error)) {
+        g_printerr("Failed to write %s: %s\n", g_journal_path, error->message);
+        g_clear_error(&error);
+    }
+    g_records = g_ops->len + (g_ops->len - g_cursor);
+    g_free(hash);
+    g_string_free(out, TRUE);
+}
+
+void journal_sync(void) {
+    g_saved_cursor = g_cursor;
+    if (!g_journal_path || !g_unsynced || g_unsynced->len == 0) return;
+
+    /* first records since opening (re)start the file with its header */
+    if (g_records == 0 || g_records + g_unsynced->len > 2 * MAX_HISTORY) {
+        compact();
+        g_ptr_array_set_size(g_unsynced, 0);
+        return;
+    }
+
+    char *hash = current_hash();
+    GString *out = g_string_new(NULL);
+    for (guint i = 0; i < g_unsynced->len; i++)
+        g_string_append_printf(out, "%s\t%s\n", (char *)g_ptr_array_index(g_unsynced, i), hash);
+    g_records += g_unsynced->len;
+    g_ptr_array_set_size(g_unsynced, 0);
+
+    FILE *f = fopen(g_journal_path, "a");
+    if (!f || fputs(out->str, f) == EOF) g_printerr("Failed to append to %s\n", g_journal_path);
+    if (f) fclose(f);
+    g_string_free(out, TRUE);
+    g_free(hash);
+}
+
+static void add_unsynced(char *record) {
+    if (!g_unsynced) g_unsynced = g_ptr_array_new_with_free_func(g_free);
+    g_ptr_array_add(g_unsynced, record);
+}
+
+static gboolean replay_line(char *line, char **hash) {
+    char **f = g_strsplit(line, "\t", 7);
+    guint n = g_strv_length(f);
+    gboolean ok = TRUE;
+
+    if (n == 7 && strcmp(f[0], "do") == 0 && strlen(f[1]) == 1) {
+        const char *code = memchr(op_codes, f[1][0], sizeof(op_codes));
+        if (!code) ok = FALSE;
+        else {
+            char *old_text = g_strcompress(f[4]), *new_text = g_strcompress(f[5]);
+            push_op(journal_op_new(code - op_codes, (int)g_ascii_strtoll(f[2], NULL, 10),
+                                   (guint)g_ascii_strtoull(f[3], NULL, 10), old_text, new_text));
+            g_free(old_text);
+            g_free(new_text);
+        }
+    } else if (n == 2 && strcmp(f[0], "undo") == 0 && g_cursor > 0) {
+        g_cursor--;
+    } else if (n == 2 && strcmp(f[0], "redo") == 0 && g_cursor < g_ops->len) {
+        g_cursor++;
+    } else {
+        ok = FALSE;
+    }
+
+    if (ok && n > 1) {
+        g_free(*hash);
+        *hash = g_strdup(f[n - 1]);
+    }
+    g_strfreev(f);
+    return ok;
+}
+
+void journal_open(void) {
+    journal_reset();
+    g_free(g_journal_path);
+    g_journal_path = g_strconcat(g_filepath, JOURNAL_SUFFIX, NULL);
+
+    char *contents = NULL;
+    if (!g_file_get_contents(g_journal_path, &contents, NULL, NULL)) return;
+
+    char **lines = g_strsplit(contents, "\n", -1);
+    char *hash = NULL;
+    gboolean ok = g_str_has_prefix(contents, JOURNAL_HEADER);
+    for (char **line = lines + 1; ok && *line; line++) {
+        if (**line == '\0') continue;
+        ok = replay_line(*line, &hash);
+        g_records++;
+    }
+
+    /* history of a config that has since been edited elsewhere is useless */
+    char *expected = current_hash();
+    if (!ok || g_strcmp0(hash, expected) != 0) {
+        journal_reset();
+        if (g_unlink(g_journal_path) == 0) g_print("Discarded stale undo history %s\n", g_journal_path);
+    }
+    g_saved_cursor = g_cursor;
+    g_free(expected);
+    g_free(hash);
+    g_strfreev(lines);
+    g_free(contents);
+}
+
+void journal_reset(void) {
+    if (!g_ops) g_ops = g_ptr_array_new_with_free_func(journal_op_free);
+    g_ptr_array_set_size(g_ops, 0);
+    if (g_unsynced) g_ptr_array_set_size(g_unsynced, 0);
+    g_cursor = 0;
+    g_saved_cursor = 0;
+    g_records = 0;
+}
+
+gboolean journal_rewind_to_saved(void) {
+    if (!g_ops || g_saved_cursor == NO_CURSOR) {
+        journal_reset();
+        return FALSE;
+    }
+    if (g_saved_cursor == g_cursor) return FALSE;
+    /* recorded like the undos and redos it stands for, so replaying the
+     * file lands on the same cursor */
+    while (g_cursor > g_saved_cursor) {
+        g_cursor--;
+        add_unsynced(g_strdup("undo"));
+    }
+    while (g_cursor < g_saved_cursor) {
+        g_cursor++;
+        add_unsynced(g_strdup("redo"));
+    }
+    return TRUE;
+}
+
+void journal_record(JournalOpType type, int section, guint row, const char *old_text,
+                    const char *new_text) {
+    if (!g_journal_path) return;
+    JournalOp *op = journal_op_new(type, section, row, old_text, new_text);
+    push_op(op);
+    add_unsynced(do_record(op));
+}
+
+/* ------------------------- undo / redo ------------------------ */
+gboolean journal_can_undo(void) {
+    return g_cursor > 0;
+}
+
+gboolean journal_can_redo(void) {
+    return g_ops && g_cursor < g_ops->len;
+}
+
+static const char *text_at(int section, guint row) {
+    if (section < 0 || section >= g_section_count) return NULL;
+    GArray *binds = g_sections[section].binds;
+    return row < binds->len ? g_array_index(binds, Keybind, row).text : NULL;
+}
+
+/* Apply op (forward) or its inverse to the model. The line it expects must
+ * be where the op says, or the history no longer describes this model. */
+static gboolean apply_op(const JournalOp *op, gboolean forward) {
+    if (op->section < 0 || op->section >= g_section_count) return FALSE;
+    guint len = g_sections[op->section].binds->len;
+
+    gboolean insert = forward ? op->type == JOURNAL_ADD : op->type == JOURNAL_DELETE;
+    if (insert) {
+        if (op->row > len) return FALSE;
+        model_insert_bind(op->section, op->row, forward ? op->new_text : op->old_text);
+        return TRUE;
+    }
+
+    /* the line is about to be replaced or removed: undoing an add removes
+     * new_text, redoing a delete removes old_text */
+    const char *expected = forward ? op->old_text : op->new_text;
+    if (g_strcmp0(text_at(op->section, op->row), expected) != 0) return FALSE;
+
+    if (op->type == JOURNAL_EDIT) model_replace_bind(op->section, op->row, forward ? op->new_text : op->old_text);
+    else model_remove_bind(op->section, op->row);
+    return TRUE;
+}
+
+static gboolean step(gboolean forward, const JournalOp **out) {
+    if (forward ? !journal_can_redo() : !journal_can_undo()) return FALSE;
+    const JournalOp *op = g_ptr_array_index(g_ops, forward ? g_cursor : g_cursor - 1);
+
+    if (!apply_op(op, forward)) {
+        g_printerr("%s no longer matches the undo history; discarding it\n", g_filepath);
+        journal_reset();
+        return FALSE;
+    }
+    keybinds_save_later();
+
+    g_cursor += forward ? 1 : -1;
+    add_unsynced(g_strdup(forward ? "redo" : "undo"));
+
+    *out = op;
+    return TRUE;
+}
+
+gboolean journal_undo(const JournalOp **op) {
+    return step(FALSE, op);
+}
+
+gboolean journal_redo(const JournalOp **op) {
+    return step(TRUE, op);
+}
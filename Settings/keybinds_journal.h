@@ -0,0 +1,57 @@
+#ifndef KEYBINDS_JOURNAL_H
+#define KEYBINDS_JOURNAL_H
+
+#include <glib.h>
+
+/* Undo/redo history of edits to g_sections, one entry per add, edit or
+ * delete of a line. Each entry carries what the inverse needs, so undoing
+ * is one model change plus one save, never a snapshot.
+ *
+ * The history is kept across restarts in an append-only journal next to
+ * the config (<config>.journal). It is only trusted while the config is
+ * still the file the journal last saw. An external edit that only touched
+ * some sections keeps it: every step first checks that its line is still
+ * at its row, and the history is dropped on the first one that is not. */
+typedef enum {
+    JOURNAL_ADD,    /* new_text inserted at row */
+    JOURNAL_DELETE, /* old_text removed from row */
+    JOURNAL_EDIT,   /* old_text at row replaced by new_text */
+} JournalOpType;
+
+typedef struct {
+    JournalOpType type;
+    int section;
+    guint row;
+    char *old_text;
+    char *new_text;
+} JournalOp;
+
+/* Load the history of g_filepath; call after parse_keybinds() */
+void journal_open(void);
+
+/* Forget the history, e.g. after g_filepath was reloaded */
+void journal_reset(void);
+
+/* A reload replaced the model with the file as last saved, dropping the
+ * edits made since: moves the history back to that save, so redo (or
+ * undo) applies them again. FALSE when there is nothing to re-apply; the
+ * history is reset if it no longer reaches back to that save. */
+gboolean journal_rewind_to_saved(void);
+
+/* An edit that was just applied to the model */
+void journal_record(JournalOpType type, int section, guint row, const char *old_text,
+                    const char *new_text);
+
+/* The config was saved with every edit so far; append them to the journal,
+ * tagged with its new hash */
+void journal_sync(void);
+
+gboolean journal_can_undo(void);
+gboolean journal_can_redo(void);
+
+/* Revert / reapply one edit and queue the config for saving. On success *op (owned
+ * by the journal) says which line changed so views can be updated. */
+gboolean journal_undo(const JournalOp **op);
+gboolean journal_redo(const JournalOp **op);
+
+#endif // KEYBINDS_JOURNAL_H
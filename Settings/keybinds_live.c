@@ -0,0 +1,151 @@
+#include "keybinds_live.h"
+#include "hypr_ipc.h"
+#include <json-glib/json-glib.h>
+#include <string.h>
+
+/* ------------------------- commands ------------------------ */
+/* "bindel = SUPER, T, exec, kitty" -> "keyword bindel SUPER, T, exec, kitty" */
+static char *bind_command(const char *text) {
+    const char *eq = strchr(text, '=');
+    if (!eq) return NULL;
+    char *keyword = g_strstrip(g_strndup(text, eq - text));
+    char *value = g_strstrip(g_strdup(eq + 1));
+    char *command = g_strdup_printf("keyword %s %s", keyword, value);
+    g_free(value);
+    g_free(keyword);
+    return command;
+}
+
+/* "submap = name" enters a submap, "submap = reset" leaves it */
+static void track_submap(const char *line, gboolean *in_submap) {
+    while (*line == ' ' || *line == '\t') line++;
+    if (!g_str_has_prefix(line, "submap")) return;
+    const char *p = line + strlen("submap");
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p != '=') return;
+    char *name = g_strstrip(g_strdup(p + 1));
+    *in_submap = strcmp(name, "reset") != 0 && *name != '\0';
+    g_free(name);
+}
+
+/* Adds a command for every bind of s on a dirty chord; FALSE when one of
+ * them cannot be sent as a keyword */
+static gboolean rebind_section(const Section *s, GHashTable *dirty, gboolean *in_submap, GPtrArray *commands) {
+    for (guint j = 0; j < s->binds->len; j++) {
+        const Keybind *kb = &g_array_index(s->binds, Keybind, j);
+        if (!keybind_is_bind(kb)) {
+            track_submap(kb->text, in_submap);
+            continue;
+        }
+        guint64 chord = ((guint64)kb->key << 16) | kb->mods;
+        if (!g_hash_table_contains(dirty, &chord)) continue;
+
+        /* a keyword bind always lands in the global map */
+        char *command = *in_submap ? NULL : bind_command(kb->text);
+        if (!command) return FALSE;
+        g_ptr_array_add(commands, command);
+    }
+    return TRUE;
+}
+
+GPtrArray *keybinds_live_commands(const KeybindsDelta *delta) {
+    if (delta->needs_reload) return NULL;
+
+    GHashTable *dirty = g_hash_table_new(g_int64_hash, g_int64_equal);
+    GPtrArray *commands = g_ptr_array_new_with_free_func(g_free);
+
+    /* unbind drops every bind on the chord, including the unchanged ones... */
+    for (guint i = 0; i < delta->chords->len; i++) {
+        KeybindChord *c = &g_array_index(delta->chords, KeybindChord, i);
+        g_hash_table_add(dirty, &c->chord);
+        g_ptr_array_add(commands, g_strdup_printf("keyword unbind %s", c->unbind));
+    }
+
+    /* ...so every bind left on it is bound again, in include order; a
+     * submap left open at the end of a file stays open in the next one */
+    gboolean ok = TRUE, in_submap = FALSE;
+    for (int f = 0; f < g_file_count && ok; f++) {
+        GPtrArray *preamble = g_files[f].preamble;
+        for (guint i = 0; preamble && i < preamble->len; i++)
+            track_submap(g_ptr_array_index(preamble, i), &in_submap);
+
+        for (int s = 0; s < g_section_count && ok; s++) {
+            if (g_sections[s].file == f) ok = rebind_section(&g_sections[s], dirty, &in_submap, commands);
+        }
+    }
+
+    g_hash_table_destroy(dirty);
+    if (!ok) {
+        g_ptr_array_unref(commands);
+        return NULL;
+    }
+    return commands;
+}
+
+/* ------------------------- apply ------------------------ */
+typedef enum {
+    AUTORELOAD_UNKNOWN,
+    AUTORELOAD_ON,
+    AUTORELOAD_OFF,
+} Autoreload;
+
+/* Asked once, and again after anything that may have changed it */
+static Autoreload g_autoreload = AUTORELOAD_UNKNOWN;
+
+static gboolean query_autoreload_disabled(void) {
+    char *reply = hypr_ipc_request("j/getoption misc:disable_autoreload", NULL);
+    if (!reply) return FALSE;
+
+    gboolean disabled = FALSE;
+    JsonParser *parser = json_parser_new();
+    if (json_parser_load_from_data(parser, reply, -1, NULL)) {
+        JsonNode *root = json_parser_get_root(parser);
+        if (JSON_NODE_HOLDS_OBJECT(root))
+            disabled = json_object_get_int_member_with_default(json_node_get_object(root), "int", 0) != 0;
+    }
+    g_object_unref(parser);
+    g_free(reply);
+    return disabled;
+}
+
+static gboolean autoreload_disabled(void) {
+    if (g_autoreload == AUTORELOAD_UNKNOWN)
+        g_autoreload = query_autoreload_disabled() ? AUTORELOAD_OFF : AUTORELOAD_ON;
+    return g_autoreload == AUTORELOAD_OFF;
+}
+
+/* With autoreload on, Hyprland re-reads the whole file by itself after
+ * every write. Keywords on top of that would be extra work and a reload
+ * would be a second one, so nothing is sent. */
+static void apply_delta(const KeybindsDelta *delta) {
+    static gboolean told = FALSE;
+    if (!autoreload_disabled()) {
+        if (!told)
+            g_print("Hyprland reloads %s itself after every write; set misc:disable_autoreload = true "
+                    "to have edits applied live instead\n", g_filepath);
+        told = TRUE;
+        /* the write may be the one that turns it off */
+        if (delta->needs_reload) g_autoreload = AUTORELOAD_UNKNOWN;
+        return;
+    }
+
+    GError *error = NULL;
+    GPtrArray *commands = keybinds_live_commands(delta);
+    if (!commands) {
+        commands = g_ptr_array_new_with_free_func(g_free);
+        g_ptr_array_add(commands, g_strdup("reload"));
+        /* ...or turns it back on */
+        g_autoreload = AUTORELOAD_UNKNOWN;
+    }
+
+    if (!hypr_ipc_run(commands, &error)) {
+        g_printerr("Failed to apply keybinds to Hyprland: %s\n", error->message);
+        g_clear_error(&error);
+    }
+    g_ptr_array_unref(commands);
+}
+
+void keybinds_live_enable(void) {
+    g_autoreload = AUTORELOAD_UNKNOWN;
+    keybinds_set_live_apply_handler(hypr_ipc_available() ? apply_delta : NULL);
+}
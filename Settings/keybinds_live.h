@@ -0,0 +1,21 @@
+#ifndef KEYBINDS_LIVE_H
+#define KEYBINDS_LIVE_H
+
+#include "keybinds_model.h"
+
+/* Push every successful write of g_filepath into the running Hyprland
+ * over its request socket: the chords that changed are unbound and bound
+ * again from the model, instead of Hyprland re-reading the whole config.
+ * The file is still written first and stays the source of truth. Does
+ * nothing outside Hyprland, and nothing while Hyprland's own autoreload is
+ * on (the default): it re-reads the file after the write anyway, so this
+ * needs misc:disable_autoreload = true. Calling it again re-reads that
+ * option, e.g. after hypr_ipc_set_transport(). */
+void keybinds_live_enable(void);
+
+/* The hyprctl commands that bring Hyprland in line with the model after
+ * delta; NULL when only a reload can (binds inside a submap, changed
+ * variables...). Exposed for testing against a mock socket. */
+GPtrArray *keybinds_live_commands(const KeybindsDelta *delta);
+
+#endif // KEYBINDS_LIVE_H
@@ -0,0 +1,1338 @@
+#include "keybinds_model.h"
+#include "keybinds_cache.h"
+#include "keybind_conflicts.h"
+#include "keybind_search.h"
+#include "stats.h"
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ------------------------- globals ------------------------ */
+Section *g_sections = NULL;
+int g_section_count = 0;
+char g_filepath[512];
+ConfigFile *g_files = NULL;
+int g_file_count = 0;
+GPtrArray *g_include_dirs = NULL;
+static GArray *g_include_stamps = NULL;  /* gint64 mtime_ns of each of g_include_dirs, -1 if missing */
+WriteDurability g_write_durability = WRITE_DURABLE;
+
+static void (*g_external_edit_handler)(void) = NULL;
+static void (*g_live_apply_handler)(const KeybindsDelta *delta) = NULL;
+
+void keybinds_set_external_edit_handler(void (*handler)(void)) {
+    g_external_edit_handler = handler;
+}
+
+void keybinds_set_live_apply_handler(void (*handler)(const KeybindsDelta *delta)) {
+    g_live_apply_handler = handler;
+}
+
+/* ------------------------- utilities ------------------------ */
+static gboolean is_blank(const char *s) {
+    if (!s) return TRUE;
+    while (*s) {
+        if (*s != ' ' && *s != '\t' && *s != '\r' && *s != '\n') return FALSE;
+        s++;
+    }
+    return TRUE;
+}
+
+/* ------------------------- pending delta ------------------------ */
+/* Chords touched by model edits since the last write. Only collected while
+ * someone will consume them (the UI or --apply, not settings-bench). */
+static KeybindsDelta g_delta;
+static GHashTable *g_delta_seen = NULL; /* guint64 chords already in g_delta */
+
+static void chord_free(gpointer data) {
+    g_free(((KeybindChord *)data)->unbind);
+}
+
+static void delta_clear(void) {
+    if (g_delta.chords) g_array_set_size(g_delta.chords, 0);
+    if (g_delta_seen) g_hash_table_remove_all(g_delta_seen);
+    g_delta.needs_reload = FALSE;
+}
+
+/* "bind = SUPER SHIFT, T, exec, kitty" -> "SUPER SHIFT, T" */
+static char *unbind_args(const char *text) {
+    const char *eq = strchr(text, '=');
+    if (!eq) return NULL;
+    const char *mods_end = strchr(eq + 1, ',');
+    const char *key_end = mods_end ? strchr(mods_end + 1, ',') : NULL;
+    if (!key_end) return NULL;
+    char *args = g_strndup(eq + 1, key_end - eq - 1);
+    return g_strstrip(args);
+}
+
+static void delta_note(const Keybind *kb) {
+    if (!g_live_apply_handler || !kb->text) return;
+    if (!keybind_is_bind(kb)) {
+        /* comments and blank lines are invisible to Hyprland */
+        const char *p = kb->text;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p && *p != '#') g_delta.needs_reload = TRUE;
+        return;
+    }
+
+    KeybindChord c = { ((guint64)kb->key << 16) | kb->mods, unbind_args(kb->text) };
+    if (kb->key == 0 || !c.unbind) {
+        g_free(c.unbind);
+        g_delta.needs_reload = TRUE;
+        return;
+    }
+    if (!g_delta.chords) {
+        g_delta.chords = g_array_new(FALSE, FALSE, sizeof(KeybindChord));
+        g_array_set_clear_func(g_delta.chords, chord_free);
+    }
+    if (!g_delta_seen) g_delta_seen = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, NULL);
+    if (!g_hash_table_add(g_delta_seen, g_memdup2(&c.chord, sizeof(c.chord)))) {
+        g_free(c.unbind);
+        return;
+    }
+    g_array_append_val(g_delta.chords, c);
+}
+
+/* ------------------------- string arena ------------------------ */
+/* Lines read from a file live in that file's GStringChunk, lines typed in
+ * edits in this one, so the whole model is released by free_keybinds()
+ * in a few shots. Lines dropped by edits and reloads stay behind until
+ * keybinds_trim() compacts them away. */
+static GStringChunk *g_arena = NULL;
+static gsize g_live_bytes = 0;  /* in use as of the last parse or compaction */
+static gsize g_dead_bytes = 0;  /* dropped since */
+
+static void drop_line(const char *line) {
+    if (line) g_dead_bytes += strlen(line) + 1;
+}
+
+char *keybinds_strdup(const char *line) {
+    if (!g_arena) g_arena = g_string_chunk_new(4096);
+    return g_string_chunk_insert(g_arena, line);
+}
+
+static void config_file_clear(ConfigFile *f) {
+    g_free(f->path);
+    if (f->preamble) g_ptr_array_free(f->preamble, TRUE);
+    if (f->arena) g_string_chunk_free(f->arena);
+}
+
+void free_keybinds(void) {
+    for (int i = 0; i < g_section_count; i++)
+        g_array_free(g_sections[i].binds, TRUE);
+    free(g_sections);
+    g_sections = NULL;
+    g_section_count = 0;
+
+    for (int i = 0; i < g_file_count; i++) config_file_clear(&g_files[i]);
+    g_free(g_files);
+    g_files = NULL;
+    g_file_count = 0;
+    if (g_include_dirs) g_ptr_array_unref(g_include_dirs);
+    g_include_dirs = NULL;
+    if (g_include_stamps) g_array_set_size(g_include_stamps, 0);
+    if (g_arena) g_string_chunk_free(g_arena);
+    g_arena = NULL;
+    g_live_bytes = g_dead_bytes = 0;
+    conflicts_clear();
+    search_clear();
+    delta_clear();
+}
+
+/* ------------------------- disk state ------------------------ */
+/* Bumped whenever g_sections is re-read from disk, which makes the section
+ * hashes of a write still in flight meaningless */
+static guint g_generation = 0;
+
+/* FNV-1a; only used to tell "same bytes" from "different bytes" */
+static guint64 hash_extend(guint64 h, const char *data, gsize len) {
+    for (gsize i = 0; i < len; i++) {
+        h ^= (guchar)data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+#define HASH_INIT 14695981039346656037ULL
+
+static guint64 hash_bytes(const char *data, gsize len) {
+    return hash_extend(HASH_INIT, data, len);
+}
+
+guint64 keybinds_hash(const char *data, gsize len) {
+    return hash_bytes(data, len);
+}
+
+static void remember_disk_stamp(ConfigFile *f, guint64 hash) {
+    GStatBuf st;
+    f->disk.hash = hash;
+    if (g_stat(f->path, &st) != 0) return;
+    f->disk.mtime_ns = (gint64)st.st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) + st.st_mtim.tv_nsec;
+    f->disk.size = st.st_size;
+}
+
+static gint64 dir_stamp(const char *dir) {
+    GStatBuf st;
+    if (g_stat(dir, &st) != 0) return -1;
+    return (gint64)st.st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) + st.st_mtim.tv_nsec;
+}
+
+static void remember_include_stamps(void) {
+    if (!g_include_stamps) g_include_stamps = g_array_new(FALSE, FALSE, sizeof(gint64));
+    g_array_set_size(g_include_stamps, 0);
+    for (guint i = 0; g_include_dirs && i < g_include_dirs->len; i++) {
+        gint64 stamp = dir_stamp(g_ptr_array_index(g_include_dirs, i));
+        g_array_append_val(g_include_stamps, stamp);
+    }
+}
+
+/* An entry was added to or removed from a directory that decides what is
+ * sourced: the set of files may be different */
+static gboolean includes_changed(void) {
+    for (guint i = 0; g_include_dirs && i < g_include_dirs->len; i++) {
+        if (i >= g_include_stamps->len
+            || dir_stamp(g_ptr_array_index(g_include_dirs, i)) != g_array_index(g_include_stamps, gint64, i))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static ConfigFile *find_file(const char *path) {
+    for (int i = 0; i < g_file_count; i++)
+        if (strcmp(g_files[i].path, path) == 0) return &g_files[i];
+    return NULL;
+}
+
+static gboolean file_changed_on_disk(ConfigFile *f) {
+    GStatBuf st;
+    if (g_stat(f->path, &st) != 0) return FALSE;
+    gint64 mtime_ns = (gint64)st.st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) + st.st_mtim.tv_nsec;
+    if (mtime_ns == f->disk.mtime_ns && st.st_size == f->disk.size) return FALSE;
+
+    /* touched but maybe not modified (e.g. our own rename landing late) */
+    gchar *contents = NULL;
+    gsize len = 0;
+    if (!g_file_get_contents(f->path, &contents, &len, NULL)) return FALSE;
+    guint64 hash = hash_bytes(contents, len);
+    g_free(contents);
+    /* our own write landing before its completion was processed */
+    if (f->disk.saving_hash && hash == f->disk.saving_hash) return FALSE;
+    gboolean changed = hash != f->disk.hash;
+
+    if (!changed) {
+        f->disk.mtime_ns = mtime_ns;
+        f->disk.size = st.st_size;
+    }
+    return changed;
+}
+
+gboolean keybinds_changed_on_disk(void) {
+    for (int i = 0; i < g_file_count; i++)
+        if (file_changed_on_disk(&g_files[i])) return TRUE;
+    return FALSE;
+}
+
+guint64 keybinds_disk_hash(void) {
+    guint64 h = HASH_INIT;
+    for (int i = 0; i < g_file_count; i++)
+        h = hash_extend(h, (const char *)&g_files[i].disk.hash, sizeof(guint64));
+    return h;
+}
+
+const char *keybinds_locate(int section_index, guint row, guint *line) {
+    const Section *s = &g_sections[section_index];
+    *line = row < s->binds->len ? g_array_index(s->binds, Keybind, row).line : 0;
+    return g_files[s->file].path;
+}
+
+/* ------------------------- scanning ------------------------ */
+static void span_trim(const char **start, const char **end) {
+    while (*start < *end && (**start == ' ' || **start == '\t')) (*start)++;
+    while (*end > *start && ((*end)[-1] == ' ' || (*end)[-1] == '\t'
+                             || (*end)[-1] == '\r' || (*end)[-1] == '\n'))
+        (*end)--;
+}
+
+/* "$name = value" lines feed modifier resolution ($mainMod, ...) */
+static void scan_variable(const char *line, const char *line_end) {
+    const char *t = line, *t_end = line_end;
+    span_trim(&t, &t_end);
+    if (t == t_end || *t != '$') return;
+
+    const char *eq = memchr(t, '=', t_end - t);
+    if (!eq) return;
+    const char *name = t + 1, *name_end = eq;
+    const char *value = eq + 1, *value_end = t_end;
+    span_trim(&name, &name_end);
+    span_trim(&value, &value_end);
+    if (name == name_end) return;
+    keybind_set_variable(name, name_end - name, value, value_end - value);
+}
+
+/* "source = path": the value, comment stripped, or NULL */
+static gboolean source_value(const char *t, const char *t_end, const char **value, const char **value_end) {
+    if (t_end - t < 6 || memcmp(t, "source", 6) != 0) return FALSE;
+    const char *p = t + 6;
+    while (p < t_end && (*p == ' ' || *p == '\t')) p++;
+    if (p == t_end || *p != '=') return FALSE;
+    *value = p + 1;
+    const char *hash = memchr(*value, '#', t_end - *value);
+    *value_end = hash ? hash : t_end;
+    span_trim(value, value_end);
+    return *value < *value_end;
+}
+
+/* Lines that decide how the rest of the config reads: a change to one of
+ * these is never a change to a single section */
+static gboolean is_layout_line(const char *t, const char *t_end) {
+    const char *v, *v_end;
+    return (t < t_end && *t == '$') || source_value(t, t_end, &v, &v_end);
+}
+
+/* A section's raw bytes: its "##" line up to the next section's */
+typedef struct {
+    const char *start;
+    const char *end;
+    guint line;  /* of the "##" line, 1-based */
+} SectionSpan;
+
+/* Splits the file into preamble + section spans without copying anything.
+ * The first header must start in column 0; later ones may be indented. */
+static GArray *scan_sections(const char *data, const char *end, const char **preamble_end) {
+    GArray *spans = g_array_new(FALSE, FALSE, sizeof(SectionSpan));
+    *preamble_end = end;
+    guint line = 0;
+
+    for (const char *p = data; p && p < end;) {
+        const char *nl = memchr(p, '\n', end - p);
+        const char *line_end = nl ? nl + 1 : end;
+        const char *t = p;
+        line++;
+        if (spans->len > 0)
+            while (t < line_end && (*t == ' ' || *t == '\t')) t++;
+
+        if (line_end - t >= 2 && t[0] == '#' && t[1] == '#') {
+            if (spans->len == 0) *preamble_end = p;
+            else g_array_index(spans, SectionSpan, spans->len - 1).end = p;
+            SectionSpan span = { p, end, line };
+            g_array_append_val(spans, span);
+        }
+        p = line_end;
+    }
+    return spans;
+}
+
+/* Materializes one section; lines are copied from the mapping into arena.
+ * Touches no shared state, so files can be parsed on several threads once
+ * the variables are known. */
+static void parse_section(Section *s, GStringChunk *arena, const SectionSpan *span) {
+    const char *nl = memchr(span->start, '\n', span->end - span->start);
+    const char *p = nl ? nl + 1 : span->end;
+    guint line = span->line;
+
+    const char *header = span->start, *header_end = p;
+    span_trim(&header, &header_end);
+    header += 2; /* "##" */
+    span_trim(&header, &header_end);
+    s->header = g_string_chunk_insert_len(arena, header, header_end - header);
+    s->binds = g_array_new(FALSE, FALSE, sizeof(Keybind));
+    s->hash = hash_bytes(span->start, span->end - span->start);
+    s->dirty = FALSE;
+
+    while (p < span->end) {
+        nl = memchr(p, '\n', span->end - p);
+        const char *line_end = nl ? nl + 1 : span->end;
+        const char *t = p, *t_end = line_end;
+        span_trim(&t, &t_end);
+        p = line_end;
+        line++;
+        if (t == t_end) continue;
+
+        Keybind kb;
+        keybind_parse(&kb, g_string_chunk_insert_len(arena, t, t_end - t));
+        kb.line = line;
+        g_array_append_val(s->binds, kb);
+    }
+}
+
+static void index_section(Section *s) {
+    for (guint j = 0; j < s->binds->len; j++) {
+        Keybind *kb = &g_array_index(s->binds, Keybind, j);
+        conflicts_add(kb);
+        kb->id = search_add(s->header, kb);
+    }
+}
+
+static void unindex_section(Section *s) {
+    for (guint j = 0; j < s->binds->len; j++) {
+        Keybind *kb = &g_array_index(s->binds, Keybind, j);
+        conflicts_remove(kb);
+        search_remove(kb->id);
+    }
+}
+
+/* ------------------------- include graph ------------------------ */
+/* One file on its way into the model. scan_file() and parse_file() run on
+ * a thread pool, one file per task; everything in between (following the
+ * includes, defining variables in include order) is on the calling thread. */
+typedef struct {
+    const char *start;
+    const char *end;
+    int first_source;  /* -1 for a $variable, else its range in sources */
+    int n_sources;
+} ScanEvent;
+
+typedef struct {
+    char *path;
+    int parent;
+    guint source_line;
+    GError *error;
+
+    GMappedFile *mapped;
+    const char *data, *end, *preamble_end;
+    GArray *spans;           /* SectionSpan */
+    GArray *events;          /* ScanEvent, in file order */
+    GPtrArray *sources;      /* paths named by source lines, globs expanded */
+    GArray *source_lines;    /* guint, line of each of sources */
+    GArray *source_scans;    /* int, FileScan index of each of sources */
+    GPtrArray *glob_dirs;    /* directories globbed by source lines */
+    guint64 hash;
+    guint64 layout_hash;
+
+    GStringChunk *arena;
+    GPtrArray *preamble;
+    Section *sections;
+    int section_count;
+} FileScan;
+
+static void file_scan_free(gpointer data) {
+    FileScan *fs = data;
+    g_free(fs->path);
+    g_clear_error(&fs->error);
+    if (fs->mapped) g_mapped_file_unref(fs->mapped);
+    if (fs->spans) g_array_unref(fs->spans);
+    if (fs->events) g_array_unref(fs->events);
+    if (fs->sources) g_ptr_array_unref(fs->sources);
+    if (fs->source_lines) g_array_unref(fs->source_lines);
+    if (fs->source_scans) g_array_unref(fs->source_scans);
+    if (fs->glob_dirs) g_ptr_array_unref(fs->glob_dirs);
+    /* installed files own these, see install_scans() */
+    if (fs->arena) g_string_chunk_free(fs->arena);
+    if (fs->preamble) g_ptr_array_free(fs->preamble, TRUE);
+    for (int i = 0; i < fs->section_count; i++) g_array_free(fs->sections[i].binds, TRUE);
+    free(fs->sections);
+    g_free(fs);
+}
+
+static FileScan *file_scan_new(const char *path, int parent, guint source_line) {
+    FileScan *fs = g_new0(FileScan, 1);
+    fs->path = g_strdup(path);
+    fs->parent = parent;
+    fs->source_line = source_line;
+    return fs;
+}
+
+/* As Hyprland resolves them: ~ is $HOME, relative paths are relative to the
+ * sourcing file, globs expand in sorted order */
+static void resolve_source(const char *from, const char *value, const char *value_end, guint line,
+                           FileScan *fs) {
+    char *pattern = g_strndup(value, value_end - value);
+    char *full;
+    if (pattern[0] == '~' && (pattern[1] == '/' || pattern[1] == '\0')) {
+        full = g_build_filename(g_get_home_dir(), pattern + 1, NULL);
+    } else if (!g_path_is_absolute(pattern)) {
+        char *dir = g_path_get_dirname(from);
+        full = g_build_filename(dir, pattern, NULL);
+        g_free(dir);
+    } else {
+        full = g_strdup(pattern);
+    }
+
+    /* a file appearing there changes what is sourced */
+    if (strpbrk(full, "*?[")) {
+        if (!fs->glob_dirs) fs->glob_dirs = g_ptr_array_new_with_free_func(g_free);
+        g_ptr_array_add(fs->glob_dirs, g_path_get_dirname(full));
+    }
+
+    /* GLOB_NOCHECK: a plain path that does not exist is kept and reported */
+    glob_t matches;
+    if (glob(full, GLOB_NOCHECK, NULL, &matches) == 0) {
+        for (size_t i = 0; i < matches.gl_pathc; i++) {
+            g_ptr_array_add(fs->sources, g_strdup(matches.gl_pathv[i]));
+            g_array_append_val(fs->source_lines, line);
+        }
+        globfree(&matches);
+    }
+    g_free(full);
+    g_free(pattern);
+}
+
+/* Maps the file and finds its sections, variables and includes */
+static void scan_file(gpointer data, gpointer user_data) {
+    FileScan *fs = data;
+    fs->mapped = g_mapped_file_new(fs->path, FALSE, &fs->error);
+    if (!fs->mapped) return;
+
+    fs->data = g_mapped_file_get_contents(fs->mapped);
+    fs->end = fs->data + g_mapped_file_get_length(fs->mapped);
+    fs->spans = scan_sections(fs->data, fs->end, &fs->preamble_end);
+    fs->events = g_array_new(FALSE, FALSE, sizeof(ScanEvent));
+    fs->sources = g_ptr_array_new_with_free_func(g_free);
+    fs->source_lines = g_array_new(FALSE, FALSE, sizeof(guint));
+    fs->hash = hash_bytes(fs->data, fs->end - fs->data);
+    fs->layout_hash = hash_bytes(fs->data, fs->preamble_end - fs->data);
+
+    guint line = 0;
+    for (const char *p = fs->data; p && p < fs->end;) {
+        const char *nl = memchr(p, '\n', fs->end - p);
+        const char *line_end = nl ? nl + 1 : fs->end;
+        const char *t = p, *t_end = line_end;
+        span_trim(&t, &t_end);
+        gboolean in_preamble = p < fs->preamble_end;
+        p = line_end;
+        line++;
+        if (!is_layout_line(t, t_end)) continue;
+
+        /* the preamble is hashed whole above */
+        if (!in_preamble) fs->layout_hash = hash_extend(fs->layout_hash, t, t_end - t);
+        ScanEvent ev = { t, t_end, -1, 0 };
+        const char *v, *v_end;
+        if (source_value(t, t_end, &v, &v_end)) {
+            ev.first_source = fs->sources->len;
+            resolve_source(fs->path, v, v_end, line, fs);
+            ev.n_sources = fs->sources->len - ev.first_source;
+        }
+        g_array_append_val(fs->events, ev);
+    }
+}
+
+/* Copies the file into its own arena as preamble + sections */
+static void parse_file(gpointer data, gpointer user_data) {
+    FileScan *fs = data;
+    fs->arena = g_string_chunk_new(MAX(4096, (gsize)(fs->end - fs->data)));
+    fs->preamble = g_ptr_array_new();
+
+    /* preamble is kept verbatim, newline included */
+    for (const char *p = fs->data; p && p < fs->preamble_end;) {
+        const char *nl = memchr(p, '\n', fs->preamble_end - p);
+        const char *line_end = nl ? nl + 1 : fs->preamble_end;
+        g_ptr_array_add(fs->preamble, g_string_chunk_insert_len(fs->arena, p, line_end - p));
+        p = line_end;
+    }
+
+    fs->section_count = fs->spans->len;
+    fs->sections = malloc(MAX(fs->section_count, 1) * sizeof(Section));
+    for (int i = 0; i < fs->section_count; i++)
+        parse_section(&fs->sections[i], fs->arena, &g_array_index(fs->spans, SectionSpan, i));
+}
+
+/* Runs func over every item on a pool sized to the machine; returns when
+ * all are done */
+static void run_parallel(GPtrArray *items, GFunc func) {
+    guint threads = MIN(items->len, g_get_num_processors());
+    if (threads <= 1) {
+        for (guint i = 0; i < items->len; i++) func(g_ptr_array_index(items, i), NULL);
+        return;
+    }
+    GThreadPool *pool = g_thread_pool_new(func, NULL, threads, TRUE, NULL);
+    for (guint i = 0; i < items->len; i++) g_thread_pool_push(pool, g_ptr_array_index(items, i), NULL);
+    g_thread_pool_free(pool, FALSE, TRUE);
+}
+
+/* Index of path in scans, adding it (and to wave) the first time it is
+ * seen; a file sourced twice, or in a cycle, is only read once */
+static int add_scan(GPtrArray *scans, GHashTable *seen, GPtrArray *wave, const char *path, int parent,
+                    guint source_line) {
+    char *real = realpath(path, NULL);
+    char *key = g_strdup(real ? real : path);
+    free(real);
+
+    gpointer index;
+    if (g_hash_table_lookup_extended(seen, key, NULL, &index)) {
+        g_free(key);
+        return GPOINTER_TO_INT(index);
+    }
+    FileScan *fs = file_scan_new(path, parent, source_line);
+    g_hash_table_insert(seen, key, GINT_TO_POINTER(scans->len));
+    g_ptr_array_add(scans, fs);
+    g_ptr_array_add(wave, fs);
+    return scans->len - 1;
+}
+
+/* Depth first, the order Hyprland reads things in: defines the variables
+ * and lists the files as they are reached */
+static void walk_includes(GPtrArray *scans, int index, GArray *order, gboolean *walked) {
+    FileScan *fs = g_ptr_array_index(scans, index);
+    if (walked[index] || fs->error) return;
+    walked[index] = TRUE;
+    g_array_append_val(order, index);
+
+    for (guint i = 0; i < fs->events->len; i++) {
+        const ScanEvent *ev = &g_array_index(fs->events, ScanEvent, i);
+        if (ev->first_source < 0) {
+            scan_variable(ev->start, ev->end);
+            continue;
+        }
+        for (int k = ev->first_source; k < ev->first_source + ev->n_sources; k++)
+            walk_includes(scans, g_array_index(fs->source_scans, int, k), order, walked);
+    }
+}
+
+/* Where the set of included files could change without any of them
+ * changing: globbed directories, and those of includes that are missing */
+static GPtrArray *collect_include_dirs(GPtrArray *scans) {
+    GPtrArray *dirs = g_ptr_array_new_with_free_func(g_free);
+    for (guint i = 0; i < scans->len; i++) {
+        FileScan *fs = g_ptr_array_index(scans, i);
+        for (guint j = 0; fs->glob_dirs && j < fs->glob_dirs->len; j++) {
+            const char *dir = g_ptr_array_index(fs->glob_dirs, j);
+            if (!g_ptr_array_find_with_equal_func(dirs, dir, g_str_equal, NULL)) g_ptr_array_add(dirs, g_strdup(dir));
+        }
+        if (i > 0 && fs->error) {
+            char *dir = g_path_get_dirname(fs->path);
+            if (g_ptr_array_find_with_equal_func(dirs, dir, g_str_equal, NULL)) g_free(dir);
+            else g_ptr_array_add(dirs, dir);
+        }
+    }
+    return dirs;
+}
+
+/* Replaces the model with the parsed files, in include order */
+static Section *install_scans(GPtrArray *scans, GArray *order, int *out_section_count) {
+    int total = 0;
+    int *file_of_scan = g_new(int, scans->len);
+    for (guint i = 0; i < scans->len; i++) file_of_scan[i] = -1;
+    for (guint i = 0; i < order->len; i++) {
+        int index = g_array_index(order, int, i);
+        file_of_scan[index] = i;
+        total += ((FileScan *)g_ptr_array_index(scans, index))->section_count;
+    }
+
+    free_keybinds();
+    g_file_count = order->len;
+    g_files = g_new0(ConfigFile, g_file_count);
+    g_include_dirs = collect_include_dirs(scans);
+    Section *sections = malloc(MAX(total, 1) * sizeof(Section));
+    int count = 0;
+
+    for (int i = 0; i < g_file_count; i++) {
+        FileScan *fs = g_ptr_array_index(scans, g_array_index(order, int, i));
+        ConfigFile *f = &g_files[i];
+        f->path = g_steal_pointer(&fs->path);
+        f->preamble = g_steal_pointer(&fs->preamble);
+        f->arena = g_steal_pointer(&fs->arena);
+        f->parent = fs->parent >= 0 ? file_of_scan[fs->parent] : -1;
+        f->source_line = fs->source_line;
+        remember_disk_stamp(f, fs->hash);
+        f->disk.layout_hash = fs->layout_hash;
+
+        for (int j = 0; j < fs->section_count; j++) {
+            sections[count] = fs->sections[j];
+            sections[count].file = i;
+            count++;
+        }
+        fs->section_count = 0;
+    }
+
+    g_free(file_of_scan);
+    keybinds_index(sections, count, TRUE);
+    *out_section_count = count;
+    return sections;
+}
+
+void keybinds_index(Section *sections, int section_count, gboolean search) {
+    for (int i = 0; i < section_count; i++) {
+        if (search) {
+            index_section(&sections[i]);
+            continue;
+        }
+        for (guint j = 0; j < sections[i].binds->len; j++)
+            conflicts_add(&g_array_index(sections[i].binds, Keybind, j));
+    }
+
+    g_live_bytes = 0;
+    for (int i = 0; i < g_file_count; i++) g_live_bytes += g_files[i].disk.size;
+    g_dead_bytes = 0;
+    remember_include_stamps();
+    g_generation++;
+}
+
+/* ------------------------- parse ------------------------ */
+/* Reads filepath and every file it sources. Files are mapped and walked
+ * line by line with memchr, one thread per file, a wave of includes at a
+ * time; lines are copied straight from the mapping into the file's arena,
+ * so there is no line length limit and no per-line heap allocation. On
+ * success the previous model is freed and replaced (g_files and the
+ * arenas); the caller installs the returned sections as g_sections. */
+static Section *parse_files(const char *filepath, int *out_section_count, GError **error) {
+    gint64 span = stats_begin();
+    GPtrArray *scans = g_ptr_array_new_with_free_func(file_scan_free);
+    GHashTable *seen = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    GPtrArray *wave = g_ptr_array_new();
+    add_scan(scans, seen, wave, filepath, -1, 0);
+
+    while (wave->len > 0) {
+        run_parallel(wave, scan_file);
+        GPtrArray *next = g_ptr_array_new();
+        for (guint i = 0; i < wave->len; i++) {
+            FileScan *fs = g_ptr_array_index(wave, i);
+            if (fs->error) continue;
+            guint parent;
+            g_ptr_array_find(scans, fs, &parent);
+            fs->source_scans = g_array_sized_new(FALSE, FALSE, sizeof(int), fs->sources->len);
+            for (guint k = 0; k < fs->sources->len; k++) {
+                int child = add_scan(scans, seen, next, g_ptr_array_index(fs->sources, k), parent,
+                                     g_array_index(fs->source_lines, guint, k));
+                g_array_append_val(fs->source_scans, child);
+            }
+        }
+        g_ptr_array_unref(wave);
+        wave = next;
+    }
+    g_ptr_array_unref(wave);
+    g_hash_table_destroy(seen);
+
+    FileScan *root = g_ptr_array_index(scans, 0);
+    if (root->error) {
+        g_propagate_prefixed_error(error, g_steal_pointer(&root->error), "Failed to open %s: ", filepath);
+        g_ptr_array_unref(scans);
+        return NULL;
+    }
+    for (guint i = 1; i < scans->len; i++) {
+        FileScan *fs = g_ptr_array_index(scans, i);
+        FileScan *parent = g_ptr_array_index(scans, fs->parent);
+        if (fs->error)
+            g_printerr("%s:%u: cannot source %s: %s\n", parent->path, fs->source_line, fs->path,
+                       fs->error->message);
+    }
+
+    /* before the walk defines them again, never after: the binds parsed
+     * below and every later edit resolve $mainMod through this table */
+    keybind_clear_variables();
+    GArray *order = g_array_new(FALSE, FALSE, sizeof(int));
+    gboolean *walked = g_new0(gboolean, scans->len);
+    walk_includes(scans, 0, order, walked);
+    g_free(walked);
+
+    GPtrArray *ordered = g_ptr_array_sized_new(order->len);
+    for (guint i = 0; i < order->len; i++)
+        g_ptr_array_add(ordered, g_ptr_array_index(scans, g_array_index(order, int, i)));
+    run_parallel(ordered, parse_file);
+    g_ptr_array_unref(ordered);
+
+    Section *sections = install_scans(scans, order, out_section_count);
+    g_array_unref(order);
+    g_ptr_array_unref(scans);
+    stats_end(STATS_PARSE, span);
+    return sections;
+}
+
+Section *parse_keybinds(const char *filepath, int *out_section_count) {
+    GError *error = NULL;
+    Section *sections = parse_files(filepath, out_section_count, &error);
+    if (!sections) {
+        g_printerr("%s\n", error->message);
+        g_clear_error(&error);
+    }
+    return sections;
+}
+
+/* ------------------------- background load ------------------------ */
+static void load_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+    int *count = task_data;
+    GError *error = NULL;
+    Section *sections = keybinds_cache_load(g_filepath, count);
+    if (!sections) {
+        sections = parse_files(g_filepath, count, &error);
+        if (sections) keybinds_cache_save(g_filepath, sections, *count);
+    }
+    if (sections) g_task_return_pointer(task, sections, NULL);
+    else g_task_return_error(task, error);
+}
+
+void keybinds_load_async(GAsyncReadyCallback callback, gpointer user_data) {
+    GTask *task = g_task_new(NULL, NULL, callback, user_data);
+    g_task_set_task_data(task, g_new0(int, 1), g_free);
+    g_task_run_in_thread(task, load_thread);
+    g_object_unref(task);
+}
+
+gboolean keybinds_load_finish(GAsyncResult *result, GError **error) {
+    Section *sections = g_task_propagate_pointer(G_TASK(result), error);
+    if (!sections) return FALSE;
+    g_sections = sections;
+    g_section_count = *(int *)g_task_get_task_data(G_TASK(result));
+    return TRUE;
+}
+
+/* ------------------------- reload ------------------------ */
+/* Re-reads one changed file into the live model, touching only sections
+ * whose bytes changed. Returns FALSE when its layout changed (preamble,
+ * variables, includes, number of sections) or a changed section has edits
+ * not written yet, which cannot be merged: both need a full
+ * parse_keybinds(). Indices of the changed sections are appended to
+ * changed. */
+static gboolean reparse_changed_sections(int file, GArray *changed) {
+    ConfigFile *f = &g_files[file];
+    FileScan *fs = file_scan_new(f->path, -1, 0);
+    scan_file(fs, NULL);
+
+    int count = 0;
+    for (int i = 0; i < g_section_count; i++) count += g_sections[i].file == file;
+    gboolean same_layout = !fs->error && (int)fs->spans->len == count
+                           && fs->layout_hash == f->disk.layout_hash;
+    for (int i = 0, k = 0; same_layout && i < g_section_count; i++) {
+        if (g_sections[i].file != file) continue;
+        const SectionSpan *span = &g_array_index(fs->spans, SectionSpan, k++);
+        if (g_sections[i].dirty && hash_bytes(span->start, span->end - span->start) != g_sections[i].hash)
+            same_layout = FALSE;
+    }
+    if (!same_layout) {
+        file_scan_free(fs);
+        return FALSE;
+    }
+
+    guint k = 0;
+    for (int i = 0; i < g_section_count; i++) {
+        if (g_sections[i].file != file) continue;
+        const SectionSpan *span = &g_array_index(fs->spans, SectionSpan, k++);
+        if (hash_bytes(span->start, span->end - span->start) == g_sections[i].hash) continue;
+
+        unindex_section(&g_sections[i]);
+        drop_line(g_sections[i].header);
+        for (guint j = 0; j < g_sections[i].binds->len; j++)
+            drop_line(g_array_index(g_sections[i].binds, Keybind, j).text);
+        g_array_free(g_sections[i].binds, TRUE);
+        parse_section(&g_sections[i], f->arena, span);
+        g_sections[i].file = file;
+        index_section(&g_sections[i]);
+        g_array_append_val(changed, i);
+    }
+
+    remember_disk_stamp(f, fs->hash);
+    file_scan_free(fs);
+    return TRUE;
+}
+
+static void cancel_save(void);
+
+gboolean keybinds_has_unsaved_edits(void) {
+    for (int i = 0; i < g_file_count; i++)
+        if (g_files[i].dirty) return TRUE;
+    return FALSE;
+}
+
+/* Files whose stamp did not move are not even read. Edits not written yet
+ * survive a partial reload and are written once it is done. A section
+ * edited both here and on disk takes a full reload, which drops them; the
+ * caller tells the user (keybinds_has_unsaved_edits() before the call). */
+KeybindsReload keybinds_reload(GArray *changed) {
+    gboolean full = includes_changed(), any = full;
+    for (int i = 0; i < g_file_count && !full; i++) {
+        if (!file_changed_on_disk(&g_files[i])) continue;
+        any = TRUE;
+        full = !reparse_changed_sections(i, changed);
+    }
+    if (!any) return KEYBINDS_RELOAD_NONE;
+    if (!full) {
+        g_generation++;
+        /* as safe here as the reload itself: both replace lines */
+        keybinds_trim();
+        if (keybinds_has_unsaved_edits()) keybinds_save_later();
+        return KEYBINDS_RELOAD_SECTIONS;
+    }
+
+    int count = 0;
+    Section *sections = parse_keybinds(g_filepath, &count);
+    if (!sections) return KEYBINDS_RELOAD_FAILED;
+    cancel_save();
+    delta_clear();
+    g_sections = sections;
+    g_section_count = count;
+    return KEYBINDS_RELOAD_FULL;
+}
+
+/* ------------------------- write ------------------------ */
+/* One file to write. The lines live in arenas, which a reload may free, so
+ * the snapshot handed to the writer is the serialized buffer itself, never
+ * the sections. */
+typedef struct {
+    int section;
+    guint64 hash;
+    gboolean dirty;  /* the section's edits are in this write */
+} SectionHash;
+
+typedef struct {
+    char *path;
+    gboolean is_model;     /* one of g_files, not an export */
+    GString *buf;
+    int mode;
+    guint64 hash;
+    guint64 layout_hash;
+    GArray *section_hashes; /* SectionHash */
+    gboolean ok;
+} FileWrite;
+
+/* One write of the config: every edited file, plus what the model needs to
+ * learn once they are on disk */
+typedef struct {
+    GPtrArray *files;      /* FileWrite */
+    GFileSetContentsFlags flags;
+    guint generation;      /* g_generation when serialized */
+    KeybindsDelta delta;   /* edits included in this write */
+    gint64 span;
+    gboolean ok;
+} SaveJob;
+
+static void file_write_free(gpointer data) {
+    FileWrite *w = data;
+    g_free(w->path);
+    g_string_free(w->buf, TRUE);
+    g_array_unref(w->section_hashes);
+    g_free(w);
+}
+
+static void save_job_free(gpointer data) {
+    SaveJob *job = data;
+    g_ptr_array_unref(job->files);
+    if (job->delta.chords) g_array_unref(job->delta.chords);
+    g_free(job);
+}
+
+/* Serializes the sections of file into a buffer for path. Lines are
+ * renumbered to where they will be once it lands. */
+static FileWrite *serialize_file(int file, const char *path, Section *sections, int section_count) {
+    ConfigFile *f = &g_files[file];
+    FileWrite *w = g_new0(FileWrite, 1);
+    w->path = g_strdup(path);
+    w->is_model = strcmp(path, f->path) == 0;
+    w->section_hashes = g_array_new(FALSE, FALSE, sizeof(SectionHash));
+    GString *buf = w->buf = g_string_sized_new(4096);
+
+    if (f->preamble) {
+        for (size_t i = 0; i < f->preamble->len; i++) {
+            g_string_append(buf, g_ptr_array_index(f->preamble, i));
+        }
+    }
+    w->layout_hash = hash_bytes(buf->str, buf->len);
+    guint line = f->preamble ? f->preamble->len : 0;
+
+    for (int i = 0; i < section_count; i++) {
+        if (sections[i].file != file) continue;
+        gsize section_start = buf->len;
+        g_string_append(buf, "## ");
+        g_string_append(buf, sections[i].header);
+        g_string_append_c(buf, '\n');
+        line++;
+        GArray *binds = sections[i].binds;
+        for (size_t j = 0; j < binds->len; j++) {
+            Keybind *kb = &g_array_index(binds, Keybind, j);
+            const char *text = kb->text;
+            if (!text) continue;
+            if (is_blank(text)) continue;
+            g_string_append(buf, text);
+            g_string_append_c(buf, '\n');
+            if (w->is_model) kb->line = ++line;
+            if (is_layout_line(text, text + strlen(text)))
+                w->layout_hash = hash_extend(w->layout_hash, text, strlen(text));
+        }
+        SectionHash sh = { i, hash_bytes(buf->str + section_start, buf->len - section_start), sections[i].dirty };
+        g_array_append_val(w->section_hashes, sh);
+    }
+    w->hash = hash_bytes(buf->str, buf->len);
+
+    /* keep the permissions of the file we replace */
+    w->mode = 0644;
+    GStatBuf st;
+    if (g_stat(path, &st) == 0) w->mode = st.st_mode & 07777;
+    return w;
+}
+
+static SaveJob *save_job_new(void) {
+    SaveJob *job = g_new0(SaveJob, 1);
+    job->span = stats_begin();
+    job->files = g_ptr_array_new_with_free_func(file_write_free);
+    job->generation = g_generation;
+    job->flags = G_FILE_SET_CONTENTS_CONSISTENT;
+    if (g_write_durability == WRITE_DURABLE)
+        job->flags |= G_FILE_SET_CONTENTS_DURABLE;
+    return job;
+}
+
+/* Every file with edits; the edits pending so far are the ones this write
+ * carries */
+static SaveJob *serialize_edited(Section *sections, int section_count) {
+    SaveJob *job = save_job_new();
+    for (int i = 0; i < g_file_count; i++) {
+        if (!g_files[i].dirty) continue;
+        g_files[i].dirty = FALSE;
+        FileWrite *w = serialize_file(i, g_files[i].path, sections, section_count);
+        for (int j = 0; j < section_count; j++)
+            if (sections[j].file == i) sections[j].dirty = FALSE;
+        g_files[i].disk.saving_hash = w->hash;
+        g_ptr_array_add(job->files, w);
+    }
+    job->delta = g_delta;
+    g_delta.chords = NULL;
+    delta_clear();
+    return job;
+}
+
+/* The file a path names once symlinks are followed. Dotfile managers link
+ * the config into place; renaming over the link itself would turn it into
+ * a regular file and the edits would never reach the linked-to copy. A
+ * dangling link is followed by hand, so the write creates its target. */
+static char *resolve_write_target(const char *path) {
+    char *real = realpath(path, NULL);
+    if (real) {
+        char *target = g_strdup(real);
+        free(real);
+        return target;
+    }
+
+    char *target = g_strdup(path);
+    for (int hops = 0; hops < 40 && g_file_test(target, G_FILE_TEST_IS_SYMLINK); hops++) {
+        char *link = g_file_read_link(target, NULL);
+        if (!link) break;
+        char *next;
+        if (g_path_is_absolute(link)) {
+            next = g_strdup(link);
+        } else {
+            char *dir = g_path_get_dirname(target);
+            next = g_build_filename(dir, link, NULL);
+            g_free(dir);
+        }
+        g_free(link);
+        g_free(target);
+        target = next;
+    }
+    return target;
+}
+
+/* g_file_set_contents_full() writes a temp file next to each file's
+ * symlink target and rename()s it over that. Readers (Hyprland's reload)
+ * only ever see the old or the new file, never a truncated one. Safe on
+ * any thread. */
+static void write_job(SaveJob *job) {
+    job->ok = TRUE;
+    for (guint i = 0; i < job->files->len; i++) {
+        FileWrite *w = g_ptr_array_index(job->files, i);
+        GError *error = NULL;
+        char *target = resolve_write_target(w->path);
+        w->ok = g_file_set_contents_full(target, w->buf->str, w->buf->len, job->flags, w->mode, &error);
+        if (!w->ok) {
+            g_printerr("Failed to write %s: %s\n", target, error->message);
+            g_clear_error(&error);
+            job->ok = FALSE;
+        }
+        g_free(target);
+    }
+    stats_end(STATS_REWRITE, job->span);
+}
+
+/* Back on the main thread: what the files now look like on disk, for the
+ * next reload, and the running compositor */
+static void finish_job(SaveJob *job) {
+    gboolean same_model = job->generation == g_generation;
+    for (guint i = 0; i < job->files->len; i++) {
+        FileWrite *w = g_ptr_array_index(job->files, i);
+        ConfigFile *f = w->is_model ? find_file(w->path) : NULL;
+        if (!f) continue;
+        f->disk.saving_hash = 0;
+        if (!w->ok) {
+            /* retried with the next write */
+            if (!same_model) continue;
+            f->dirty = TRUE;
+            for (guint j = 0; j < w->section_hashes->len; j++) {
+                const SectionHash *sh = &g_array_index(w->section_hashes, SectionHash, j);
+                if (sh->dirty && sh->section < g_section_count) g_sections[sh->section].dirty = TRUE;
+            }
+            continue;
+        }
+        remember_disk_stamp(f, w->hash);
+        f->disk.layout_hash = w->layout_hash;
+        if (!same_model) continue;
+        for (guint j = 0; j < w->section_hashes->len; j++) {
+            const SectionHash *sh = &g_array_index(w->section_hashes, SectionHash, j);
+            if (sh->section < g_section_count) g_sections[sh->section].hash = sh->hash;
+        }
+    }
+
+    if (job->ok && g_live_apply_handler
+        && (job->delta.needs_reload || (job->delta.chords && job->delta.chords->len)))
+        g_live_apply_handler(&job->delta);
+}
+
+/* Serializes and writes right away. Refuses to overwrite edits made to any
+ * of the files since we last read them. */
+gboolean rewrite_config(const char *filepath, Section *sections, int section_count) {
+    if (g_file_count == 0) return FALSE;
+    gboolean is_model = strcmp(filepath, g_files[0].path) == 0;
+    if (is_model && keybinds_changed_on_disk()) {
+        g_printerr("%s changed on disk, not overwriting it; reloading\n", filepath);
+        delta_clear();
+        if (g_external_edit_handler) g_external_edit_handler();
+        return FALSE;
+    }
+
+    SaveJob *job;
+    if (is_model) {
+        job = serialize_edited(sections, section_count);
+    } else {
+        job = save_job_new();
+        g_ptr_array_add(job->files, serialize_file(0, filepath, sections, section_count));
+    }
+    write_job(job);
+    finish_job(job);
+    gboolean ok = job->ok;
+    save_job_free(job);
+    return ok;
+}
+
+gboolean set_write_durability(const char *name) {
+    if (g_strcmp0(name, "consistent") == 0) g_write_durability = WRITE_CONSISTENT;
+    else if (g_strcmp0(name, "durable") == 0) g_write_durability = WRITE_DURABLE;
+    else return FALSE;
+    return TRUE;
+}
+
+/* ------------------------- write-behind ------------------------ */
+/* Edits only mark the model dirty. Once they stop for SAVE_DEBOUNCE_MS the
+ * edited files are serialized on the main thread and written by a worker;
+ * a burst of deletes costs one write. At most one write is in flight, so
+ * they land in order; edits made meanwhile go into the next one. */
+#define SAVE_DEBOUNCE_MS 250
+
+static guint g_save_source = 0;
+static gboolean g_save_dirty = FALSE;
+static gboolean g_save_in_flight = FALSE;
+static void (*g_save_state_handler)(KeybindsSaveState state) = NULL;
+
+void keybinds_set_save_state_handler(void (*handler)(KeybindsSaveState state)) {
+    g_save_state_handler = handler;
+}
+
+static void set_save_state(KeybindsSaveState state) {
+    if (g_save_state_handler) g_save_state_handler(state);
+}
+
+static void start_save(void);
+
+static void save_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+    SaveJob *job = task_data;
+    write_job(job);
+    g_task_return_boolean(task, job->ok);
+}
+
+static void on_save_done(GObject *source_object, GAsyncResult *result, gpointer user_data) {
+    SaveJob *job = g_task_get_task_data(G_TASK(result));
+    g_save_in_flight = FALSE;
+    finish_job(job);
+
+    if (!job->ok) {
+        /* retried with the next edit, or at the latest on quit */
+        g_save_dirty = TRUE;
+        set_save_state(KEYBINDS_SAVE_FAILED);
+    } else if (!g_save_dirty) {
+        set_save_state(KEYBINDS_SAVED);
+    } else if (!g_save_source) {
+        start_save();
+    }
+}
+
+static void start_save(void) {
+    if (g_save_in_flight || !g_save_dirty) return;
+    g_save_dirty = FALSE;
+
+    /* the edits stay marked on their files (and in the delta): the reload
+     * this schedules writes them again, unless it has to drop them */
+    if (keybinds_changed_on_disk()) {
+        g_printerr("%s changed on disk, not overwriting it; reloading\n", g_filepath);
+        set_save_state(KEYBINDS_SAVE_PENDING);
+        if (g_external_edit_handler) g_external_edit_handler();
+        return;
+    }
+
+    SaveJob *job = serialize_edited(g_sections, g_section_count);
+    g_save_in_flight = TRUE;
+    set_save_state(KEYBINDS_SAVING);
+
+    GTask *task = g_task_new(NULL, NULL, on_save_done, NULL);
+    g_task_set_task_data(task, job, save_job_free);
+    g_task_run_in_thread(task, save_thread);
+    g_object_unref(task);
+}
+
+static gboolean on_save_timeout(gpointer user_data) {
+    g_save_source = 0;
+    /* straight from the main loop: nothing holds a line pointer here */
+    keybinds_trim();
+    start_save();
+    return G_SOURCE_REMOVE;
+}
+
+void keybinds_save_later(void) {
+    g_save_dirty = TRUE;
+    if (g_save_source) g_source_remove(g_save_source);
+    g_save_source = g_timeout_add(SAVE_DEBOUNCE_MS, on_save_timeout, NULL);
+    if (!g_save_in_flight) set_save_state(KEYBINDS_SAVE_PENDING);
+}
+
+/* A full reload replaced the model the pending edits were made to */
+static void cancel_save(void) {
+    if (g_save_source) {
+        g_source_remove(g_save_source);
+        g_save_source = 0;
+    }
+    g_save_dirty = FALSE;
+}
+
+gboolean keybinds_save_flush(void) {
+    if (g_save_source) {
+        g_source_remove(g_save_source);
+        g_save_source = 0;
+    }
+    while (g_save_in_flight) g_main_context_iteration(NULL, TRUE);
+    if (!g_save_dirty) return TRUE;
+    g_save_dirty = FALSE;
+
+    /* no reload is coming after this one (we are likely quitting): merge
+     * the external edit right here and write on top of it, unless it
+     * replaced the model the edits were made to */
+    if (keybinds_changed_on_disk()) {
+        GArray *changed = g_array_new(FALSE, FALSE, sizeof(int));
+        KeybindsReload result = keybinds_reload(changed);
+        g_array_unref(changed);
+        /* the partial reload queued a write; it is done below instead */
+        cancel_save();
+        if (result == KEYBINDS_RELOAD_FULL || result == KEYBINDS_RELOAD_FAILED) {
+            g_printerr("%s changed on disk before the last edits were saved; they were not saved\n",
+                       g_filepath);
+            set_save_state(KEYBINDS_SAVE_FAILED);
+            return FALSE;
+        }
+    }
+
+    gboolean ok = rewrite_config(g_filepath, g_sections, g_section_count);
+    set_save_state(ok ? KEYBINDS_SAVED : KEYBINDS_SAVE_FAILED);
+    return ok;
+}
+
+/* ------------------------- model edits ------------------------ */
+/* All changes to g_sections go through these so the indexes stay in sync
+ * and the right file gets written */
+static void mark_edited(int section_index) {
+    g_sections[section_index].dirty = TRUE;
+    g_files[g_sections[section_index].file].dirty = TRUE;
+}
+
+void model_remove_bind(int section_index, guint row) {
+    GArray *binds = g_sections[section_index].binds;
+    Keybind *kb = &g_array_index(binds, Keybind, row);
+    delta_note(kb);
+    conflicts_remove(kb);
+    search_remove(kb->id);
+    drop_line(kb->text);
+    g_array_remove_index(binds, row);
+    mark_edited(section_index);
+}
+
+void model_replace_bind(int section_index, guint row, const char *text) {
+    Keybind *kb = &g_array_index(g_sections[section_index].binds, Keybind, row);
+    guint32 line = kb->line;
+    delta_note(kb);
+    conflicts_remove(kb);
+    search_remove(kb->id);
+    drop_line(kb->text);
+    keybind_parse(kb, keybinds_strdup(text));
+    kb->line = line;
+    delta_note(kb);
+    conflicts_add(kb);
+    kb->id = search_add(g_sections[section_index].header, kb);
+    mark_edited(section_index);
+}
+
+void model_insert_bind(int section_index, guint row, const char *text) {
+    Keybind kb;
+    keybind_parse(&kb, keybinds_strdup(text));
+    delta_note(&kb);
+    conflicts_add(&kb);
+    kb.id = search_add(g_sections[section_index].header, &kb);
+    g_array_insert_val(g_sections[section_index].binds, row, kb);
+    mark_edited(section_index);
+}
+
+guint model_append_bind(int section_index, const char *text) {
+    guint row = g_sections[section_index].binds->len;
+    model_insert_bind(section_index, row, text);
+    return row;
+}
+
+/* New sections go at the end of g_filepath itself */
+int model_append_section(const char *header) {
+    g_sections = realloc(g_sections, (g_section_count + 1) * sizeof(Section));
+    Section *s = &g_sections[g_section_count];
+    s->header = keybinds_strdup(header);
+    s->binds = g_array_new(FALSE, FALSE, sizeof(Keybind));
+    s->hash = 0;
+    s->file = 0;
+    mark_edited(g_section_count);
+    return g_section_count++;
+}
+
+/* ------------------------- compaction ------------------------ */
+/* Below this much garbage a compaction is not worth its copy */
+#define COMPACT_MIN_DEAD (64 * 1024)
+
+/* Copies every live line into fresh per-file arenas and frees the old
+ * ones, edits' included. The search index is rebuilt on the way, which
+ * also retires the ids edits tombstoned in it. Section and row indices
+ * are unchanged; every line pointer and search id is not. */
+static void compact(void) {
+    GStringChunk **arenas = g_new(GStringChunk *, g_file_count);
+    gsize live = 0;
+
+    for (int i = 0; i < g_file_count; i++) {
+        GPtrArray *preamble = g_files[i].preamble;
+        arenas[i] = g_string_chunk_new(4096);
+        for (guint j = 0; preamble && j < preamble->len; j++) {
+            const char *line = g_ptr_array_index(preamble, j);
+            live += strlen(line) + 1;
+            g_ptr_array_index(preamble, j) = g_string_chunk_insert(arenas[i], line);
+        }
+    }
+
+    search_clear();
+    for (int i = 0; i < g_section_count; i++) {
+        Section *s = &g_sections[i];
+        GStringChunk *arena = arenas[s->file];
+        live += strlen(s->header) + 1;
+        s->header = g_string_chunk_insert(arena, s->header);
+        for (guint j = 0; j < s->binds->len; j++) {
+            Keybind *kb = &g_array_index(s->binds, Keybind, j);
+            if (kb->text) {
+                live += strlen(kb->text) + 1;
+                kb->text = g_string_chunk_insert(arena, kb->text);
+            }
+            kb->id = search_add(s->header, kb);
+        }
+    }
+
+    for (int i = 0; i < g_file_count; i++) {
+        if (g_files[i].arena) g_string_chunk_free(g_files[i].arena);
+        g_files[i].arena = arenas[i];
+    }
+    g_free(arenas);
+    if (g_arena) g_string_chunk_free(g_arena);
+    g_arena = NULL;
+
+    g_live_bytes = live;
+    g_dead_bytes = 0;
+}
+
+void keybinds_trim(void) {
+    if (g_dead_bytes > MAX(COMPACT_MIN_DEAD, g_live_bytes)) compact();
+}
@@ -0,0 +1,150 @@
+#ifndef KEYBINDS_MODEL_H
+#define KEYBINDS_MODEL_H
+
+#include <gio/gio.h>
+#include "keybind.h"
+
+/* The parsed keybinds.conf and everything that reads, edits and writes it.
+ * No GTK in here: the UI (keybinds.h) and settings-bench both sit on top.
+ *
+ * g_filepath may pull in more files with "source = path" lines (globs, ~
+ * and paths relative to the sourcing file work as in Hyprland). Each one
+ * is a ConfigFile; its sections are in g_sections like the root's, and
+ * edits only rewrite the files they touched. */
+
+typedef struct Section {
+    const char *header;  /* arena-owned */
+    GArray *binds;       /* Keybind, lines in file order */
+    guint64 hash;        /* content hash as last read from / written to disk */
+    int file;            /* index into g_files */
+    gboolean dirty;      /* edited since it was last written */
+} Section;
+
+typedef struct {
+    char *path;
+    GPtrArray *preamble;   /* verbatim lines before the first "##", newline included */
+    GStringChunk *arena;   /* its parsed lines */
+    int parent;            /* file whose "source =" pulled it in, -1 for g_filepath */
+    guint source_line;     /* that line, 1-based */
+    gboolean dirty;        /* edited since it was last written */
+    struct {
+        gint64 mtime_ns;
+        gint64 size;
+        guint64 hash;
+        guint64 layout_hash;  /* preamble, $variables and source lines */
+        guint64 saving_hash;  /* content of a write still in flight, 0 if none */
+    } disk;                /* what we last read from or wrote to path */
+} ConfigFile;
+
+/* How hard rewrite_config() works to get the file onto disk. Both levels
+ * replace the file atomically; WRITE_DURABLE also fsyncs before renaming. */
+typedef enum {
+    WRITE_CONSISTENT,
+    WRITE_DURABLE,
+} WriteDurability;
+
+extern Section *g_sections;
+extern int g_section_count;
+extern char g_filepath[512];
+extern ConfigFile *g_files;  /* in include order, the root file first */
+extern int g_file_count;
+/* Directories whose listing decides which files are sourced (globs,
+ * missing includes), NULL when there are none. keybinds_reload() parses
+ * everything again once one of them changed. */
+extern GPtrArray *g_include_dirs;
+extern WriteDurability g_write_durability;
+
+Section *parse_keybinds(const char *filepath, int *out_section_count);
+void free_keybinds(void);
+/* parse_keybinds(g_filepath) on a worker thread, so a window can be up
+ * before the file is read. Nothing may touch the model until callback
+ * runs; keybinds_load_finish() then installs the result as g_sections.
+ * An unchanged config is loaded from its cache (keybinds_cache.h). */
+void keybinds_load_async(GAsyncReadyCallback callback, gpointer user_data);
+gboolean keybinds_load_finish(GAsyncResult *result, GError **error);
+char *keybinds_strdup(const char *line);
+/* Memory held by the model stays proportional to the config however long
+ * it is edited: once lines dropped by edits and reloads outweigh the live
+ * ones, the live lines are compacted into fresh arenas (and the search
+ * index rebuilt). Invalidates every line pointer and search id, so call
+ * it where nothing holds one; the write-behind does before each write. */
+void keybinds_trim(void);
+/* For loaders other than parse_keybinds() (keybinds_cache.c): once
+ * free_keybinds() ran and g_files is filled in, indexes sections as a
+ * parse would (the search index too, unless the loader restored it) and
+ * marks the model as freshly read */
+void keybinds_index(Section *sections, int section_count, gboolean search);
+/* The content hash of ConfigFile.disk */
+guint64 keybinds_hash(const char *data, gsize len);
+/* Given g_filepath, writes every file with edits; given any other path,
+ * writes the root file's content there (settings-bench) */
+gboolean rewrite_config(const char *filepath, Section *sections, int section_count);
+
+/* Write-behind for the UI: mark g_sections as edited and have it written
+ * to g_filepath shortly, on a worker thread, coalesced with whatever edits
+ * follow. keybinds_save_flush() blocks until everything is on disk; if a
+ * file changed there meanwhile it reloads first, and only fails (FALSE,
+ * KEYBINDS_SAVE_FAILED) when that reload drops the edits. */
+typedef enum {
+    KEYBINDS_SAVED,
+    KEYBINDS_SAVE_PENDING,  /* edited, waiting for the edits to stop */
+    KEYBINDS_SAVING,
+    KEYBINDS_SAVE_FAILED,
+} KeybindsSaveState;
+
+void keybinds_save_later(void);
+gboolean keybinds_save_flush(void);
+void keybinds_set_save_state_handler(void (*handler)(KeybindsSaveState state));
+gboolean set_write_durability(const char *name);
+
+/* Called when rewrite_config() finds g_filepath edited behind our back and
+ * refuses to write; the UI schedules a reload */
+void keybinds_set_external_edit_handler(void (*handler)(void));
+
+/* What a successful write of g_filepath changed, for
+ * pushing it into the running compositor without a full reload */
+typedef struct {
+    guint64 chord;  /* key << 16 | mods, what Hyprland's unbind matches on */
+    char *unbind;   /* "MODS, KEY" as written in the line */
+} KeybindChord;
+
+typedef struct {
+    GArray *chords;         /* KeybindChord: every chord a bind was added to or removed from */
+    gboolean needs_reload;  /* a line other than a bind changed (variable, submap...) */
+} KeybindsDelta;
+
+void keybinds_set_live_apply_handler(void (*handler)(const KeybindsDelta *delta));
+
+/* All changes to g_sections go through these so the indexes stay in sync */
+void model_remove_bind(int section_index, guint row);
+void model_replace_bind(int section_index, guint row, const char *text);
+void model_insert_bind(int section_index, guint row, const char *text);
+guint model_append_bind(int section_index, const char *text);
+int model_append_section(const char *header);
+
+/* One of g_files differs from what we last read or wrote */
+gboolean keybinds_changed_on_disk(void);
+
+/* Hash of every file's contents as we last read or wrote them */
+guint64 keybinds_disk_hash(void);
+
+/* Where a bind lives on disk; line is 0 for one not written yet */
+const char *keybinds_locate(int section_index, guint row, guint *line);
+
+typedef enum {
+    KEYBINDS_RELOAD_NONE,     /* unchanged on disk */
+    KEYBINDS_RELOAD_SECTIONS, /* indices of the re-parsed sections are in changed */
+    KEYBINDS_RELOAD_FULL,     /* layout changed; g_sections was replaced */
+    KEYBINDS_RELOAD_FAILED,   /* changed, but could not be parsed */
+} KeybindsReload;
+
+/* Edits made to the model and not yet on disk */
+gboolean keybinds_has_unsaved_edits(void);
+
+/* Merge external edits of g_filepath into the model, re-parsing only the
+ * sections whose content changed. Unsaved edits to other sections are kept
+ * and queued for writing; a FULL reload discards them. A section with
+ * unsaved edits that also changed on disk makes the reload FULL. */
+KeybindsReload keybinds_reload(GArray *changed);
+
+#endif // KEYBINDS_MODEL_H
@@ -1,58 +1,302 @@
 #include "keybinds.h"
+#include "keybinds_batch.h"
+#include "keybinds_journal.h"
+#include "keybinds_live.h"
 #include "waybar_presets.h"
+#include "waybar_reload.h"
+#include "stats.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <glib-unix.h>
 
-/* GTK4 activate callback */
-static void activate(GtkApplication *app, gpointer user_data) {
+/* --- frame timing (--stats) --- */
+static gint64 g_start_time = 0;  /* main(), monotonic usec */
+static gboolean g_first_frame_seen = FALSE;
+
+/* Frame start to the end of its paint: update, layout and paint together */
+static void on_after_paint(GdkFrameClock *clock, gpointer user_data) {
+    gint64 start = gdk_frame_clock_get_frame_time(clock);
+    gint64 now = g_get_monotonic_time();
+    stats_record(STATS_FRAME, start, now - start);
+
+    /* what launching from a hotkey feels like */
+    if (!g_first_frame_seen) {
+        g_first_frame_seen = TRUE;
+        stats_record(STATS_FIRST_FRAME, g_start_time, now - g_start_time);
+        g_print("First frame %.1f ms after launch\n", (now - g_start_time) / 1000.0);
+    }
+}
+
+static void on_window_realize(GtkWidget *window, gpointer user_data) {
+    GdkFrameClock *clock = gtk_widget_get_frame_clock(window);
+    if (clock) g_signal_connect(clock, "after-paint", G_CALLBACK(on_after_paint), NULL);
+}
+
+static gboolean on_dump_stats(gpointer user_data) {
+    stats_print_summary();
+    return G_SOURCE_CONTINUE;
+}
+
+/* The keybinds.conf both the window and --apply edit */
+static void set_default_filepath(void) {
     const char *home = getenv("HOME");
     if (!home) home = "/root";
     snprintf(g_filepath, sizeof(g_filepath), "%s/.config/hypr/config/software/keybinds.conf", home);
+}
 
-    g_sections = parse_keybinds(g_filepath, &g_section_count);
-    if (!g_sections || g_section_count == 0) {
-        g_printerr("No keybinds loaded or failed to parse file.\n");
+/* --- startup --- */
+/* Stands in for the list until keybinds.conf is parsed, and says why when
+ * it could not be */
+static GtkWidget *g_loading = NULL;
+
+static GtkWidget *create_loading_placeholder(void) {
+    GtkWidget *box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 12);
+    gtk_widget_set_halign(box, GTK_ALIGN_CENTER);
+    gtk_widget_set_valign(box, GTK_ALIGN_CENTER);
+    gtk_widget_set_vexpand(box, TRUE);
+    GtkWidget *spinner = gtk_spinner_new();
+    gtk_spinner_start(GTK_SPINNER(spinner));
+    gtk_box_append(GTK_BOX(box), spinner);
+    gtk_box_append(GTK_BOX(box), gtk_label_new("Loading keybinds…"));
+    return box;
+}
+
+static void on_keybinds_loaded(GObject *source_object, GAsyncResult *result, gpointer user_data) {
+    GError *error = NULL;
+    if (!g_main_box) {
+        /* the window went away first */
+        if (keybinds_load_finish(result, NULL)) free_keybinds();
         return;
     }
+    gtk_box_remove(GTK_BOX(g_main_box), g_loading);
+    g_loading = NULL;
+
+    if (!keybinds_load_finish(result, &error)) {
+        g_printerr("%s\n", error->message);
+        GtkWidget *label = gtk_label_new(error->message);
+        gtk_label_set_wrap(GTK_LABEL(label), TRUE);
+        gtk_widget_set_vexpand(label, TRUE);
+        gtk_box_append(GTK_BOX(g_main_box), label);
+        g_clear_error(&error);
+        return;
+    }
+    journal_open();
+    keybinds_live_enable();
+    keybinds_watch();
+    rebuild_ui();
+}
+
+static void fill_waybar_page(GtkWindow *window, GtkWidget *waybar_page) {
+    GtkWidget *tab = create_waybar_presets_tab(window);
+    gtk_widget_set_vexpand(tab, TRUE);
+    gtk_widget_set_hexpand(tab, TRUE);
+    gtk_box_append(GTK_BOX(waybar_page), tab);
+}
+
+/* The Waybar tab reads the presets directory; that waits until someone
+ * actually opens it */
+static void on_switch_page(GtkNotebook *notebook, GtkWidget *page, guint page_num, gpointer user_data) {
+    GtkWidget *waybar_page = user_data;
+    if (page != waybar_page) return;
+
+    g_signal_handlers_disconnect_by_func(notebook, on_switch_page, user_data);
+    fill_waybar_page(GTK_WINDOW(gtk_widget_get_root(GTK_WIDGET(notebook))), waybar_page);
+}
+
+/* --- resident service (--gapplication-service) --- */
+/* Started as "Settings --gapplication-service" (exec-once in hyprland.conf,
+ * or D-Bus activation of com.example.settingsapp), the process stays up
+ * with the window built but hidden. A launch then only sends "activate"
+ * over D-Bus and the window is presented as it is: no GTK init, no parse,
+ * no widgets built. Closing the window hides it; keybinds.conf and its
+ * includes stay watched, so it is current when it comes back.
+ *
+ * What stays resident while idle, and nothing else:
+ *  - the model: every config line once, in per-file arenas. Lines replaced
+ *    by edits stay behind only until keybinds_trim() compacts the arenas,
+ *    once they outweigh the live ones;
+ *  - the conflict and search indexes, one entry per bind;
+ *  - the undo history, which journal compaction keeps bounded;
+ *  - the presets list (one PresetInfo per preset) and the window's
+ *    widgets. The list view only has rows for what fits on screen, so
+ *    that part does not grow with the config.
+ * Each of these is proportional to the config or the presets directory,
+ * never to how often the window was opened. */
+static gboolean is_service(GApplication *app) {
+    return (g_application_get_flags(app) & G_APPLICATION_IS_SERVICE) != 0;
+}
+
+/* The window goes up first, keybinds.conf is parsed behind it */
+static GtkWidget *build_window(GtkApplication *app) {
+    gboolean resident = is_service(G_APPLICATION(app));
+    set_default_filepath();
 
     GtkWidget *window = gtk_application_window_new(app);
     g_app_window = window;
     gtk_window_set_title(GTK_WINDOW(window), "Keybind Settings");
     gtk_window_set_default_size(GTK_WINDOW(window), 900, 600);
+    gtk_window_set_hide_on_close(GTK_WINDOW(window), resident);
+    if (stats_enabled) g_signal_connect(window, "realize", G_CALLBACK(on_window_realize), NULL);
 
     GtkWidget *notebook = gtk_notebook_new();
     gtk_notebook_set_tab_pos(GTK_NOTEBOOK(notebook), GTK_POS_LEFT);
     gtk_window_set_child(GTK_WINDOW(window), notebook);
 
-    /* --- Keybinds tab --- */
-    GtkWidget *keybinds_tab = gtk_scrolled_window_new();
-    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(keybinds_tab),
-                                   GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
-
+    /* --- Keybinds tab (rebuild_ui adds the scrolling list view) --- */
     g_main_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 12);
     gtk_widget_set_margin_start(g_main_box, 20);
     gtk_widget_set_margin_end(g_main_box, 20);
     gtk_widget_set_margin_top(g_main_box, 20);
     gtk_widget_set_margin_bottom(g_main_box, 20);
-    gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(keybinds_tab), g_main_box);
 
-    gtk_notebook_append_page(GTK_NOTEBOOK(notebook), keybinds_tab, gtk_label_new("Keybinds"));
-    rebuild_ui();
+    g_object_add_weak_pointer(G_OBJECT(g_main_box), (gpointer *)&g_main_box);
+    g_loading = create_loading_placeholder();
+    gtk_box_append(GTK_BOX(g_main_box), g_loading);
+    gtk_notebook_append_page(GTK_NOTEBOOK(notebook), g_main_box, gtk_label_new("Keybinds"));
 
-    /* --- Waybar Presets tab --- */
-    GtkWidget *waybar_tab = create_waybar_presets_tab(GTK_WINDOW(window));
-    gtk_notebook_append_page(GTK_NOTEBOOK(notebook), waybar_tab, gtk_label_new("Waybar Presets"));
+    /* --- Waybar Presets tab, filled in on first visit (right away when
+     * resident, there is time for it then) --- */
+    GtkWidget *waybar_page = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
+    gtk_notebook_append_page(GTK_NOTEBOOK(notebook), waybar_page, gtk_label_new("Waybar Presets"));
+    if (resident) fill_waybar_page(GTK_WINDOW(window), waybar_page);
+    else g_signal_connect(notebook, "switch-page", G_CALLBACK(on_switch_page), waybar_page);
 
-    gtk_window_present(GTK_WINDOW(window));
+    keybinds_load_async(on_keybinds_loaded, NULL);
+    return window;
+}
+
+static void on_startup(GApplication *app, gpointer user_data) {
+    if (!is_service(app)) return;
+    /* stay up without a visible window */
+    g_application_hold(app);
+    build_window(GTK_APPLICATION(app));
+}
+
+/* GTK4 activate callback */
+static void activate(GtkApplication *app, gpointer user_data) {
+    if (g_app_window) {
+        /* the resident window, or a second launch: time it from here */
+        g_start_time = g_get_monotonic_time();
+        g_first_frame_seen = FALSE;
+        waybar_presets_refresh();
+        gtk_window_present(GTK_WINDOW(g_app_window));
+        return;
+    }
+    gtk_window_present(GTK_WINDOW(build_window(app)));
+}
+
+/* Edits are written behind; nothing may be lost by quitting right after one */
+static void on_shutdown(GApplication *app, gpointer user_data) {
+    if (g_sections) keybinds_save_flush();
+}
+
+/* --- headless batch edits (--apply) --- */
+static char *read_edits(const char *source, gsize *length, GError **error) {
+    char *contents = NULL;
+    if (strcmp(source, "-") != 0)
+        return g_file_get_contents(source, &contents, length, error) ? contents : NULL;
+
+    GString *buf = g_string_new(NULL);
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), stdin)) > 0) g_string_append_len(buf, chunk, n);
+    if (ferror(stdin)) {
+        g_set_error_literal(error, G_FILE_ERROR, G_FILE_ERROR_IO, "Failed to read stdin");
+        g_string_free(buf, TRUE);
+        return NULL;
+    }
+    *length = buf->len;
+    return g_string_free(buf, FALSE);
+}
+
+/* Load the model once, apply every edit in memory, write the file once.
+ * Any invalid edit leaves the file untouched. */
+static int run_batch(const char *source) {
+    set_default_filepath();
+
+    GError *error = NULL;
+    gsize length = 0;
+    char *json = read_edits(source, &length, &error);
+    if (!json) {
+        g_printerr("Failed to read edits: %s\n", error->message);
+        g_clear_error(&error);
+        return 1;
+    }
+
+    g_sections = parse_keybinds(g_filepath, &g_section_count);
+    if (!g_sections) {
+        g_free(json);
+        return 1;
+    }
+    keybinds_live_enable();
+
+    BatchCounts counts;
+    int status = 0;
+    if (!keybinds_apply_batch(json, length, &counts, &error)) {
+        g_printerr("%s left unchanged: %s\n", g_filepath, error->message);
+        g_clear_error(&error);
+        status = 1;
+    } else if (counts.added + counts.removed + counts.replaced == 0) {
+        g_print("No edits to apply\n");
+    } else if (!rewrite_config(g_filepath, g_sections, g_section_count)) {
+        status = 1;
+    } else {
+        g_print("%s: %u added, %u removed, %u replaced\n", g_filepath, counts.added,
+                counts.removed, counts.replaced);
+    }
+
+    free_keybinds();
+    g_free(json);
+    return status;
+}
+
+/* --- command line options --- */
+static char *opt_durability = NULL;
+static gboolean opt_stats = FALSE;
+static char *opt_apply = NULL;
+static char *opt_waybar_script = NULL;
+
+static const GOptionEntry option_entries[] = {
+    { "durability", 0, 0, G_OPTION_ARG_STRING, &opt_durability,
+      "How keybinds.conf is written: consistent (rename only) or durable (fsync + rename, default)", "LEVEL" },
+    { "stats", 0, 0, G_OPTION_ARG_NONE, &opt_stats,
+      "Time parsing, writes, preset jobs and frames; print a summary on exit or on SIGUSR1", NULL },
+    { "apply", 0, 0, G_OPTION_ARG_FILENAME, &opt_apply,
+      "Apply the keybind edits in FILE (JSON, - for stdin) and exit without opening a window", "FILE" },
+    { "waybar-script", 0, 0, G_OPTION_ARG_STRING, &opt_waybar_script,
+      "Run COMMAND to reload Waybar when no waybar process is running; Waybar itself is reloaded with SIGUSR2 "
+      "(default ~/Dots/Scripts/Waybar/waybar.sh, empty for none)", "COMMAND" },
+    G_OPTION_ENTRY_NULL
+};
+
+static gint handle_local_options(GApplication *app, GVariantDict *options, gpointer user_data) {
+    if (opt_durability && !set_write_durability(opt_durability)) {
+        g_printerr("Unknown durability level: %s\n", opt_durability);
+        return 1;
+    }
+    /* spans also become sysprof marks when recording under sysprof */
+    if (opt_stats || g_getenv("SYSPROF_CONTROL_FD")) stats_enable();
+    if (opt_waybar_script) waybar_reload_set_script(opt_waybar_script);
+    if (opt_apply) return run_batch(opt_apply);
+    return -1;
 }
 
 /* --- main() function --- */
 int main(int argc, char *argv[]) {
+    g_start_time = g_get_monotonic_time();
     GtkApplication *app = gtk_application_new("com.example.settingsapp",
                                               G_APPLICATION_DEFAULT_FLAGS);
+    g_application_add_main_option_entries(G_APPLICATION(app), option_entries);
+    g_signal_connect(app, "handle-local-options", G_CALLBACK(handle_local_options), NULL);
+    g_signal_connect(app, "startup", G_CALLBACK(on_startup), NULL);
     g_signal_connect(app, "activate", G_CALLBACK(activate), NULL);
+    g_signal_connect(app, "shutdown", G_CALLBACK(on_shutdown), NULL);
+    g_unix_signal_add(SIGUSR1, on_dump_stats, NULL);
 
     int status = g_application_run(G_APPLICATION(app), argc, argv);
+    if (opt_stats) stats_print_summary();
     g_object_unref(app);
     return status;
 }
@@ -0,0 +1,246 @@
+#include "preset_index.h"
+#include "preset_store.h"
+#include "file_tree.h"
+#include <string.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+#define INDEX_HEADER "# waybar preset index v1\n"
+
+/* Index lines, tab separated:
+ *   r <root> <root mtime ns>
+ *   p <mtime ns> <size> <files> <hash or -> <applied> <name> */
+static GMutex g_lock;
+static GHashTable *g_entries = NULL; /* name -> PresetInfo */
+static char *g_root = NULL;
+static gint64 g_root_mtime = -1;
+
+void preset_info_free(gpointer data) {
+    PresetInfo *info = data;
+    g_free(info->name);
+    g_free(info->hash);
+    g_free(info);
+}
+
+static PresetInfo *preset_info_copy(const PresetInfo *info) {
+    PresetInfo *copy = g_memdup2(info, sizeof(*info));
+    copy->name = g_strdup(info->name);
+    copy->hash = g_strdup(info->hash);
+    return copy;
+}
+
+static gint64 dir_mtime_ns(const char *path) {
+    GStatBuf st;
+    if (g_stat(path, &st) != 0) return -1;
+    return (gint64)st.st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) + st.st_mtim.tv_nsec;
+}
+
+static char *index_path(void) {
+    return g_build_filename(g_get_user_cache_dir(), "settings-app", "waybar-presets.index", NULL);
+}
+
+/* ------------------------- persistence ------------------------ */
+static void load_index(const char *root) {
+    char *path = index_path();
+    char *contents = NULL;
+    gboolean same_root = FALSE;
+
+    if (g_file_get_contents(path, &contents, NULL, NULL)) {
+        char **lines = g_strsplit(contents, "\n", -1);
+        for (char **line = lines; *line; line++) {
+            char **f = g_strsplit(*line, "\t", 7);
+            guint n = g_strv_length(f);
+            if (n == 3 && strcmp(f[0], "r") == 0) {
+                same_root = strcmp(f[1], root) == 0;
+                if (same_root) g_root_mtime = g_ascii_strtoll(f[2], NULL, 10);
+            } else if (same_root && n == 7 && strcmp(f[0], "p") == 0) {
+                PresetInfo *info = g_new0(PresetInfo, 1);
+                info->mtime_ns = g_ascii_strtoll(f[1], NULL, 10);
+                info->size = g_ascii_strtoll(f[2], NULL, 10);
+                info->files = g_ascii_strtoll(f[3], NULL, 10);
+                info->hash = strcmp(f[4], "-") == 0 ? NULL : g_strdup(f[4]);
+                info->applied = g_ascii_strtoll(f[5], NULL, 10);
+                info->name = g_strdup(f[6]);
+                g_hash_table_replace(g_entries, g_strdup(info->name), info);
+            }
+            g_strfreev(f);
+        }
+        g_strfreev(lines);
+    }
+
+    g_free(contents);
+    g_free(path);
+}
+
+static void save_index(void) {
+    GString *out = g_string_new(INDEX_HEADER);
+    g_string_append_printf(out, "r\t%s\t%" G_GINT64_FORMAT "\n", g_root, g_root_mtime);
+
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, g_entries);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        PresetInfo *info = value;
+        g_string_append_printf(out, "p\t%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\t%d\t%s\t%" G_GINT64_FORMAT "\t%s\n",
+                               info->mtime_ns, info->size, info->files,
+                               info->hash ? info->hash : "-", info->applied, info->name);
+    }
+
+    char *path = index_path();
+    char *dir = g_path_get_dirname(path);
+    GError *error = NULL;
+    g_mkdir_with_parents(dir, 0755);
+    if (!g_file_set_contents(path, out->str, out->len, &error)) {
+        g_printerr("Failed to write preset index: %s\n", error->message);
+        g_clear_error(&error);
+    }
+    g_free(dir);
+    g_free(path);
+    g_string_free(out, TRUE);
+}
+
+/* Switches to root, loading its index the first time; call locked */
+static void ensure_loaded(const char *root) {
+    if (g_entries && g_strcmp0(g_root, root) == 0) return;
+
+    if (g_entries) g_hash_table_remove_all(g_entries);
+    else g_entries = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, preset_info_free);
+    g_free(g_root);
+    g_root = g_strdup(root);
+    g_root_mtime = -1;
+    load_index(root);
+}
+
+/* ------------------------- validation ------------------------ */
+static PresetInfo *describe(const char *root, const char *name, gint64 mtime_ns) {
+    PresetInfo *info = g_new0(PresetInfo, 1);
+    info->name = g_strdup(name);
+    info->mtime_ns = mtime_ns;
+    if (!preset_store_describe(root, name, &info->size, &info->files, &info->hash)) {
+        /* legacy copy, imported on first apply */
+        char *dir = g_build_filename(root, name, NULL);
+        info->files = file_tree_count(dir, NULL);
+        g_free(dir);
+    }
+    return info;
+}
+
+/* (Re)describe name, keeping its last-applied time; call locked */
+static void refresh_entry(const char *root, const char *name, gint64 mtime_ns) {
+    PresetInfo *old = g_hash_table_lookup(g_entries, name);
+    PresetInfo *info = describe(root, name, mtime_ns);
+    if (old) info->applied = old->applied;
+    g_hash_table_replace(g_entries, g_strdup(name), info);
+}
+
+/* Brings the index in line with root; TRUE if anything changed. Call locked. */
+static gboolean revalidate(const char *root) {
+    gboolean dirty = FALSE;
+
+    /* Presets only come and go by entries in root itself */
+    gint64 root_mtime = dir_mtime_ns(root);
+    if (root_mtime != g_root_mtime) {
+        GHashTable *seen = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        GDir *dir = g_dir_open(root, 0, NULL);
+        const char *name;
+        while (dir && (name = g_dir_read_name(dir))) {
+            if (name[0] == '.') continue; /* the object store and in-progress imports */
+            char *path = g_build_filename(root, name, NULL);
+            gint64 mtime = g_file_test(path, G_FILE_TEST_IS_DIR) ? dir_mtime_ns(path) : -1;
+            g_free(path);
+            if (mtime < 0) continue;
+
+            g_hash_table_add(seen, g_strdup(name));
+            if (!g_hash_table_contains(g_entries, name)) refresh_entry(root, name, mtime);
+        }
+        if (dir) g_dir_close(dir);
+
+        GHashTableIter iter;
+        gpointer key;
+        g_hash_table_iter_init(&iter, g_entries);
+        while (g_hash_table_iter_next(&iter, &key, NULL)) {
+            if (!g_hash_table_contains(seen, key)) g_hash_table_iter_remove(&iter);
+        }
+        g_hash_table_unref(seen);
+        g_root_mtime = root_mtime;
+        dirty = TRUE;
+    }
+
+    /* A save adds a snapshot to the preset's directory */
+    GPtrArray *stale = g_ptr_array_new_with_free_func(g_free);
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, g_entries);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        PresetInfo *info = value;
+        char *path = g_build_filename(root, info->name, NULL);
+        if (dir_mtime_ns(path) != info->mtime_ns) g_ptr_array_add(stale, g_strdup(info->name));
+        g_free(path);
+    }
+    for (guint i = 0; i < stale->len; i++) {
+        const char *name = g_ptr_array_index(stale, i);
+        char *path = g_build_filename(root, name, NULL);
+        refresh_entry(root, name, dir_mtime_ns(path));
+        g_free(path);
+        dirty = TRUE;
+    }
+    g_ptr_array_unref(stale);
+
+    return dirty;
+}
+
+/* ------------------------- public ------------------------ */
+static int compare_infos(gconstpointer a, gconstpointer b) {
+    const PresetInfo *x = *(PresetInfo *const *)a, *y = *(PresetInfo *const *)b;
+    return g_utf8_collate(x->name, y->name);
+}
+
+GPtrArray *preset_index_list(const char *root) {
+    g_mutex_lock(&g_lock);
+    ensure_loaded(root);
+    if (revalidate(root)) save_index();
+
+    GPtrArray *list = g_ptr_array_new_full(g_hash_table_size(g_entries), preset_info_free);
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, g_entries);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) g_ptr_array_add(list, preset_info_copy(value));
+    g_mutex_unlock(&g_lock);
+
+    g_ptr_array_sort(list, compare_infos);
+    return list;
+}
+
+void preset_index_update(const char *root, const char *name) {
+    char *path = g_build_filename(root, name, NULL);
+    g_mutex_lock(&g_lock);
+    ensure_loaded(root);
+    refresh_entry(root, name, dir_mtime_ns(path));
+    save_index();
+    g_mutex_unlock(&g_lock);
+    g_free(path);
+}
+
+void preset_index_remove(const char *root, const char *name) {
+    g_mutex_lock(&g_lock);
+    ensure_loaded(root);
+    if (g_hash_table_remove(g_entries, name)) save_index();
+    g_mutex_unlock(&g_lock);
+}
+
+void preset_index_mark_applied(const char *root, const char *name) {
+    char *path = g_build_filename(root, name, NULL);
+    g_mutex_lock(&g_lock);
+    ensure_loaded(root);
+    /* applying a legacy preset imported it, so describe it afresh */
+    PresetInfo *info = g_hash_table_lookup(g_entries, name);
+    gint64 mtime = dir_mtime_ns(path);
+    if (!info || info->mtime_ns != mtime) {
+        refresh_entry(root, name, mtime);
+        info = g_hash_table_lookup(g_entries, name);
+    }
+    info->applied = g_get_real_time() / G_USEC_PER_SEC;
+    save_index();
+    g_mutex_unlock(&g_lock);
+    g_free(path);
+}
@@ -0,0 +1,31 @@
+#ifndef PRESET_INDEX_H
+#define PRESET_INDEX_H
+
+#include <glib.h>
+
+/* What the presets tab shows about one preset */
+typedef struct {
+    char *name;
+    gint64 size;
+    gint files;
+    char *hash;       /* preset_store_describe(); NULL for a legacy plain copy */
+    gint64 applied;   /* unix time of the last apply, 0 if never */
+    gint64 mtime_ns;  /* of the preset directory when this was computed */
+} PresetInfo;
+
+void preset_info_free(gpointer info);
+
+/* Index of the presets under root, kept in the user cache dir so the
+ * presets tab does not rescan and re-read every preset when it opens.
+ * Entries are revalidated against directory mtimes: root's for presets
+ * coming and going, each preset's for new snapshots. Blocking and
+ * thread-safe; call it off the main thread. Returns PresetInfo copies
+ * sorted by name. */
+GPtrArray *preset_index_list(const char *root);
+
+/* Incremental updates after a job changed one preset */
+void preset_index_update(const char *root, const char *name);
+void preset_index_remove(const char *root, const char *name);
+void preset_index_mark_applied(const char *root, const char *name);
+
+#endif // PRESET_INDEX_H
@@ -0,0 +1,927 @@
+#define _GNU_SOURCE /* renameat2 */
+#include "preset_store.h"
+#include "file_tree.h"
+#include "stats.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#define OBJECTS_DIR ".objects"
+#define MANIFEST_SUFFIX ".manifest"
+#define MANIFEST_HEADER "# waybar preset manifest v1\n"
+#define KEEP_SNAPSHOTS 10
+#define HASH_CHUNK (256 * 1024)
+
+/* One manifest line:
+ *   d <mode> <path>
+ *   f <mode> <mtime ns> <size> <sha256> <path>
+ *   l <target> <path>
+ * tab separated, path last and relative to the preset root */
+typedef struct {
+    char kind;
+    guint mode;
+    gint64 mtime_ns;
+    gint64 size;
+    char *hash;   /* f */
+    char *target; /* l */
+    char *path;
+} ManifestEntry;
+
+static void manifest_entry_free(gpointer data) {
+    ManifestEntry *e = data;
+    g_free(e->hash);
+    g_free(e->target);
+    g_free(e->path);
+    g_free(e);
+}
+
+static gboolean set_errno_error(GError **error, int saved_errno, const char *what, const char *path) {
+    g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno), "%s %s: %s",
+                what, path, g_strerror(saved_errno));
+    return FALSE;
+}
+
+static void progress_inc(gint *progress) {
+    if (progress) g_atomic_int_inc(progress);
+}
+
+/* ------------------------- blobs ------------------------ */
+static char *blob_path(const char *root, const char *hash) {
+    char prefix[3] = { hash[0], hash[1], '\0' };
+    return g_build_filename(root, OBJECTS_DIR, prefix, hash + 2, NULL);
+}
+
+static gboolean hash_file(const char *path, char **out_hash, GError **error) {
+    int fd = g_open(path, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) return set_errno_error(error, errno, "Failed to open", path);
+
+    GChecksum *sum = g_checksum_new(G_CHECKSUM_SHA256);
+    guchar *buf = g_malloc(HASH_CHUNK);
+    ssize_t n;
+    while ((n = read(fd, buf, HASH_CHUNK)) != 0) {
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            int saved_errno = errno;
+            g_free(buf);
+            g_checksum_free(sum);
+            close(fd);
+            return set_errno_error(error, saved_errno, "Failed to read", path);
+        }
+        g_checksum_update(sum, buf, n);
+    }
+    *out_hash = g_strdup(g_checksum_get_string(sum));
+    g_free(buf);
+    g_checksum_free(sum);
+    close(fd);
+    return TRUE;
+}
+
+/* Add src to the store as hash unless a blob with that hash exists */
+static gboolean store_blob(const char *root, const char *src, const char *hash,
+                           GCancellable *cancellable, GError **error) {
+    char *blob = blob_path(root, hash);
+    if (g_file_test(blob, G_FILE_TEST_EXISTS)) {
+        g_free(blob);
+        return TRUE;
+    }
+
+    char *dir = g_path_get_dirname(blob);
+    g_mkdir_with_parents(dir, 0755);
+    char *tmp = g_build_filename(dir, ".tmp-XXXXXX", NULL);
+    g_free(dir);
+
+    gboolean ok = FALSE;
+    int in = g_open(src, O_RDONLY | O_CLOEXEC, 0);
+    int out = in < 0 ? -1 : g_mkstemp_full(tmp, O_RDWR | O_CLOEXEC, 0444);
+    if (in < 0) set_errno_error(error, errno, "Failed to open", src);
+    else if (out < 0) set_errno_error(error, errno, "Failed to create", tmp);
+    else if (!file_tree_copy_fd(in, out, cancellable)) set_errno_error(error, errno, "Failed to store", src);
+    else if (close(out) != 0) set_errno_error(error, errno, "Failed to store", src);
+    else if (g_rename(tmp, blob) != 0) set_errno_error(error, errno, "Failed to store", src);
+    else ok = TRUE;
+
+    if (in >= 0) close(in);
+    if (!ok) {
+        if (out >= 0) close(out);
+        g_unlink(tmp);
+    }
+    g_free(tmp);
+    g_free(blob);
+    return ok;
+}
+
+/* ------------------------- manifests ------------------------ */
+static int compare_strings(gconstpointer a, gconstpointer b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Snapshot file names of a preset, oldest first */
+static GPtrArray *list_snapshots(const char *preset_dir) {
+    GPtrArray *names = g_ptr_array_new_with_free_func(g_free);
+    GDir *dir = g_dir_open(preset_dir, 0, NULL);
+    if (!dir) return names;
+
+    const char *name;
+    while ((name = g_dir_read_name(dir))) {
+        if (g_str_has_suffix(name, MANIFEST_SUFFIX)) g_ptr_array_add(names, g_strdup(name));
+    }
+    g_dir_close(dir);
+    g_ptr_array_sort(names, compare_strings);
+    return names;
+}
+
+static char *snapshot_path(const char *root, const char *name, const char *snapshot) {
+    char *dir = g_build_filename(root, name, NULL);
+    char *path = NULL;
+    if (snapshot) {
+        path = g_build_filename(dir, snapshot, NULL);
+    } else {
+        GPtrArray *snapshots = list_snapshots(dir);
+        if (snapshots->len > 0)
+            path = g_build_filename(dir, g_ptr_array_index(snapshots, snapshots->len - 1), NULL);
+        g_ptr_array_unref(snapshots);
+    }
+    g_free(dir);
+    return path;
+}
+
+/* Manifests are only written by us, but never let one escape dest */
+static gboolean is_safe_relpath(const char *path) {
+    if (!*path || g_path_is_absolute(path)) return FALSE;
+    for (const char *p = path; *p;) {
+        const char *slash = strchr(p, '/');
+        gsize len = slash ? (gsize)(slash - p) : strlen(p);
+        if (len == 0 || (len == 2 && p[0] == '.' && p[1] == '.')) return FALSE;
+        p += len + (slash != NULL);
+    }
+    return TRUE;
+}
+
+static GPtrArray *parse_manifest(const char *contents) {
+    GPtrArray *entries = g_ptr_array_new_with_free_func(manifest_entry_free);
+    char **lines = g_strsplit(contents, "\n", -1);
+    for (char **line = lines; *line; line++) {
+        if (**line == '\0' || **line == '#') continue;
+        char **f = g_strsplit(*line, "\t", 6);
+        guint n = g_strv_length(f);
+        ManifestEntry *e = g_new0(ManifestEntry, 1);
+        e->kind = f[0][0];
+
+        if (e->kind == 'd' && n == 3) {
+            e->mode = g_ascii_strtoull(f[1], NULL, 8);
+            e->path = g_strdup(f[2]);
+        } else if (e->kind == 'f' && n == 6) {
+            e->mode = g_ascii_strtoull(f[1], NULL, 8);
+            e->mtime_ns = g_ascii_strtoll(f[2], NULL, 10);
+            e->size = g_ascii_strtoll(f[3], NULL, 10);
+            e->hash = g_strdup(f[4]);
+            e->path = g_strdup(f[5]);
+        } else if (e->kind == 'l' && n == 3) {
+            e->target = g_strdup(f[1]);
+            e->path = g_strdup(f[2]);
+        }
+        g_strfreev(f);
+
+        if (!e->path || !is_safe_relpath(e->path) || (e->hash && strlen(e->hash) < 3)) {
+            g_printerr("Skipping bad manifest line: %s\n", *line);
+            manifest_entry_free(e);
+            continue;
+        }
+        g_ptr_array_add(entries, e);
+    }
+    g_strfreev(lines);
+    return entries;
+}
+
+static GPtrArray *load_manifest(const char *path, char **out_contents, GError **error) {
+    char *contents = NULL;
+    if (!g_file_get_contents(path, &contents, NULL, error)) return NULL;
+    GPtrArray *entries = parse_manifest(contents);
+    if (out_contents) *out_contents = contents;
+    else g_free(contents);
+    return entries;
+}
+
+/* ------------------------- queries ------------------------ */
+gboolean preset_store_has_snapshot(const char *root, const char *name) {
+    char *path = snapshot_path(root, name, NULL);
+    gboolean found = path != NULL;
+    g_free(path);
+    return found;
+}
+
+gint preset_store_count_files(const char *root, const char *name) {
+    char *path = snapshot_path(root, name, NULL);
+    GPtrArray *entries = path ? load_manifest(path, NULL, NULL) : NULL;
+    gint n = 0;
+    for (guint i = 0; entries && i < entries->len; i++) {
+        if (((ManifestEntry *)g_ptr_array_index(entries, i))->kind == 'f') n++;
+    }
+    if (entries) g_ptr_array_unref(entries);
+    g_free(path);
+    return n;
+}
+
+gboolean preset_store_describe(const char *root, const char *name, gint64 *size, gint *files,
+                               char **content_hash) {
+    char *path = snapshot_path(root, name, NULL);
+    GPtrArray *entries = path ? load_manifest(path, NULL, NULL) : NULL;
+    g_free(path);
+    if (!entries) return FALSE;
+
+    /* Over what the tree holds, not when it was written: two snapshots of
+     * the same files hash the same even when their mtimes differ */
+    GChecksum *sum = g_checksum_new(G_CHECKSUM_SHA256);
+    *size = 0;
+    *files = 0;
+    for (guint i = 0; i < entries->len; i++) {
+        ManifestEntry *e = g_ptr_array_index(entries, i);
+        const char *data = e->kind == 'f' ? e->hash : e->kind == 'l' ? e->target : "";
+        g_checksum_update(sum, (const guchar *)&e->kind, 1);
+        g_checksum_update(sum, (const guchar *)e->path, strlen(e->path) + 1);
+        g_checksum_update(sum, (const guchar *)data, strlen(data) + 1);
+        if (e->kind == 'f') {
+            *size += e->size;
+            (*files)++;
+        }
+    }
+    *content_hash = g_strdup(g_checksum_get_string(sum));
+    g_checksum_free(sum);
+    g_ptr_array_unref(entries);
+    return TRUE;
+}
+
+/* ------------------------- save ------------------------ */
+typedef struct {
+    const char *root;
+    const char *src;
+} SaveContext;
+
+/* Pool task: hash one file and add it to the store */
+static gboolean hash_and_store(gpointer item, gpointer user_data, GCancellable *cancellable,
+                               GError **error) {
+    ManifestEntry *e = item;
+    const SaveContext *ctx = user_data;
+    char *full = g_build_filename(ctx->src, e->path, NULL);
+    gboolean ok = hash_file(full, &e->hash, error)
+                  && store_blob(ctx->root, full, e->hash, cancellable, error);
+    g_free(full);
+    return ok;
+}
+
+/* Pool task: hash one file without storing it */
+static gboolean hash_only(gpointer item, gpointer user_data, GCancellable *cancellable,
+                          GError **error) {
+    ManifestEntry *e = item;
+    const SaveContext *ctx = user_data;
+    char *full = g_build_filename(ctx->src, e->path, NULL);
+    gboolean ok = hash_file(full, &e->hash, error);
+    g_free(full);
+    return ok;
+}
+
+typedef struct {
+    char *name;
+    unsigned char type;
+} DirName;
+
+static int compare_dir_names(gconstpointer a, gconstpointer b) {
+    return strcmp(((const DirName *)a)->name, ((const DirName *)b)->name);
+}
+
+/* Appends entries for the directory dir_fd (src/rel) in sorted order, so an
+ * unchanged tree gives a byte-identical manifest. Files whose size and mtime
+ * match the previous snapshot reuse its hash without being read; the rest
+ * go to the pool. Takes ownership of dir_fd. */
+static gboolean scan_tree(int dir_fd, const char *rel, const char *root, GHashTable *previous,
+                          GPtrArray *entries, FileTreePool *pool, gint *progress,
+                          GCancellable *cancellable, GError **error) {
+    DIR *dir = fdopendir(dir_fd);
+    if (!dir) {
+        close(dir_fd);
+        return set_errno_error(error, errno, "Failed to open", rel ? rel : ".");
+    }
+
+    GArray *names = g_array_new(FALSE, FALSE, sizeof(DirName));
+    struct dirent *de;
+    while ((de = readdir(dir))) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+        DirName n = { g_strdup(de->d_name), de->d_type };
+        g_array_append_val(names, n);
+    }
+    g_array_sort(names, compare_dir_names);
+
+    gboolean ok = TRUE;
+    for (guint i = 0; i < names->len && ok; i++) {
+        DirName *n = &g_array_index(names, DirName, i);
+        if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+            ok = FALSE;
+            break;
+        }
+        if (strpbrk(n->name, "\t\n")) {
+            g_printerr("Skipping %s/%s: tabs and newlines are not supported in names\n",
+                       rel ? rel : ".", n->name);
+            continue;
+        }
+
+        /* mode and mtime go into the manifest, so only links skip the stat */
+        struct stat st;
+        char *relpath = rel ? g_build_filename(rel, n->name, NULL) : g_strdup(n->name);
+        gboolean is_link = n->type == DT_LNK;
+        if (!is_link && fstatat(dirfd(dir), n->name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            ok = set_errno_error(error, errno, "Failed to stat", relpath);
+            g_free(relpath);
+            break;
+        }
+        is_link = is_link || S_ISLNK(st.st_mode);
+
+        ManifestEntry *e = g_new0(ManifestEntry, 1);
+        e->path = relpath;
+        if (is_link) {
+            char target[PATH_MAX];
+            ssize_t len = readlinkat(dirfd(dir), n->name, target, sizeof(target) - 1);
+            if (len < 0) {
+                ok = set_errno_error(error, errno, "Failed to read link", relpath);
+                manifest_entry_free(e);
+                break;
+            }
+            e->kind = 'l';
+            e->target = g_strndup(target, len);
+            g_ptr_array_add(entries, e);
+        } else if (S_ISDIR(st.st_mode)) {
+            e->kind = 'd';
+            e->mode = st.st_mode & 07777;
+            g_ptr_array_add(entries, e);
+            int child = openat(dirfd(dir), n->name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            ok = child >= 0
+                     ? scan_tree(child, relpath, root, previous, entries, pool, progress,
+                                 cancellable, error)
+                     : set_errno_error(error, errno, "Failed to open", relpath);
+        } else if (S_ISREG(st.st_mode)) {
+            e->kind = 'f';
+            e->mode = st.st_mode & 07777;
+            e->mtime_ns = (gint64)st.st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) + st.st_mtim.tv_nsec;
+            e->size = st.st_size;
+            g_ptr_array_add(entries, e);
+
+            ManifestEntry *prev = g_hash_table_lookup(previous, relpath);
+            char *prev_blob = prev && prev->hash ? blob_path(root, prev->hash) : NULL;
+            if (prev_blob && prev->size == e->size && prev->mtime_ns == e->mtime_ns
+                && g_file_test(prev_blob, G_FILE_TEST_EXISTS)) {
+                e->hash = g_strdup(prev->hash);
+                progress_inc(progress);
+            } else {
+                file_tree_pool_push(pool, e);
+            }
+            g_free(prev_blob);
+        } else {
+            manifest_entry_free(e); /* sockets, fifos, devices */
+        }
+    }
+
+    for (guint i = 0; i < names->len; i++) g_free(g_array_index(names, DirName, i).name);
+    g_array_unref(names);
+    closedir(dir);
+    return ok;
+}
+
+static void append_manifest_entry(GString *manifest, const ManifestEntry *e) {
+    switch (e->kind) {
+    case 'd':
+        g_string_append_printf(manifest, "d\t%o\t%s\n", e->mode, e->path);
+        break;
+    case 'l':
+        g_string_append_printf(manifest, "l\t%s\t%s\n", e->target, e->path);
+        break;
+    case 'f':
+        g_string_append_printf(manifest, "f\t%o\t%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\t%s\t%s\n",
+                               e->mode, e->mtime_ns, e->size, e->hash, e->path);
+        break;
+    }
+}
+
+/* Remove all but the newest KEEP_SNAPSHOTS; returns how many went */
+static guint prune_snapshots(const char *preset_dir) {
+    GPtrArray *snapshots = list_snapshots(preset_dir);
+    guint removed = 0;
+    for (guint i = 0; i + KEEP_SNAPSHOTS < snapshots->len; i++) {
+        char *path = g_build_filename(preset_dir, g_ptr_array_index(snapshots, i), NULL);
+        if (g_unlink(path) == 0) removed++;
+        g_free(path);
+    }
+    g_ptr_array_unref(snapshots);
+    return removed;
+}
+
+gboolean preset_store_save(const char *root, const char *name, const char *src,
+                           gint *progress, GCancellable *cancellable, GError **error) {
+    gint64 span = stats_begin();
+    char *preset_dir = g_build_filename(root, name, NULL);
+    char *latest = snapshot_path(root, name, NULL);
+    char *latest_contents = NULL;
+    GPtrArray *latest_entries = latest ? load_manifest(latest, &latest_contents, NULL) : NULL;
+
+    GHashTable *previous = g_hash_table_new(g_str_hash, g_str_equal);
+    for (guint i = 0; latest_entries && i < latest_entries->len; i++) {
+        ManifestEntry *e = g_ptr_array_index(latest_entries, i);
+        g_hash_table_insert(previous, e->path, e);
+    }
+
+    /* the pool may still be writing blobs when the walk fails; it is
+     * always drained before its entries are freed */
+    SaveContext ctx = { root, src };
+    GPtrArray *entries = g_ptr_array_new_with_free_func(manifest_entry_free);
+    FileTreePool *pool = file_tree_pool_new(hash_and_store, &ctx, progress, cancellable);
+    int src_fd = open(src, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    GError *walk_error = NULL;
+    gboolean ok = src_fd >= 0
+                      ? scan_tree(src_fd, NULL, root, previous, entries, pool, progress,
+                                  cancellable, &walk_error)
+                      : set_errno_error(&walk_error, errno, "Failed to open", src);
+    GError *pool_error = NULL;
+    file_tree_pool_finish(pool, &pool_error);
+    if (walk_error) {
+        g_propagate_error(error, walk_error);
+        g_clear_error(&pool_error);
+    } else if (pool_error) {
+        g_propagate_error(error, pool_error);
+        ok = FALSE;
+    }
+
+    GString *manifest = g_string_new(MANIFEST_HEADER);
+    for (guint i = 0; ok && i < entries->len; i++)
+        append_manifest_entry(manifest, g_ptr_array_index(entries, i));
+
+    if (ok && (!latest_contents || strcmp(latest_contents, manifest->str) != 0)) {
+        g_mkdir_with_parents(preset_dir, 0755);
+        char *snapshot = g_strdup_printf("%s/%016" G_GINT64_FORMAT MANIFEST_SUFFIX,
+                                         preset_dir, g_get_real_time());
+        ok = g_file_set_contents(snapshot, manifest->str, manifest->len, error);
+        g_free(snapshot);
+        if (ok && prune_snapshots(preset_dir) > 0) preset_store_gc(root);
+    }
+
+    g_string_free(manifest, TRUE);
+    g_ptr_array_unref(entries);
+    g_hash_table_unref(previous);
+    if (latest_entries) g_ptr_array_unref(latest_entries);
+    g_free(latest_contents);
+    g_free(latest);
+    g_free(preset_dir);
+    stats_end(STATS_PRESET_SAVE, span);
+    return ok;
+}
+
+/* ------------------------- apply ------------------------ */
+typedef struct {
+    const char *root;
+    int stage_fd;
+} ApplyContext;
+
+static void set_times_at(int dir_fd, const char *path, gint64 mtime_ns) {
+    struct timespec times[2] = {
+        { .tv_nsec = UTIME_OMIT },
+        { .tv_sec = mtime_ns / 1000000000, .tv_nsec = mtime_ns % 1000000000 },
+    };
+    utimensat(dir_fd, path, times, AT_SYMLINK_NOFOLLOW);
+}
+
+/* Pool task: write one file of the staged tree from its blob */
+static gboolean write_file(gpointer item, gpointer user_data, GCancellable *cancellable,
+                           GError **error) {
+    const ManifestEntry *e = item;
+    const ApplyContext *ctx = user_data;
+    char *blob = blob_path(ctx->root, e->hash);
+    gboolean ok = FALSE;
+
+    int in = g_open(blob, O_RDONLY | O_CLOEXEC, 0);
+    int out = in < 0 ? -1 : openat(ctx->stage_fd, e->path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+
+    if (in < 0) set_errno_error(error, errno, "Missing blob for", e->path);
+    else if (out < 0) set_errno_error(error, errno, "Failed to create", e->path);
+    else if (!file_tree_copy_fd(in, out, cancellable)) set_errno_error(error, errno, "Failed to write", e->path);
+    else {
+        fchmod(out, e->mode);
+        int rc = close(out);
+        out = -1;
+        if (rc != 0) set_errno_error(error, errno, "Failed to write", e->path);
+        else {
+            set_times_at(ctx->stage_fd, e->path, e->mtime_ns);
+            ok = TRUE;
+        }
+    }
+
+    if (in >= 0) close(in);
+    if (out >= 0) close(out);
+    g_free(blob);
+    return ok;
+}
+
+/* A file of dest with the right bytes goes into the stage as a second
+ * name for the same inode: nothing is copied, and the live file is not
+ * touched beyond its metadata */
+static gboolean link_file(int dest_fd, const char *from, int stage_fd, const ManifestEntry *e) {
+    if (linkat(dest_fd, from, stage_fd, e->path, 0) != 0) return FALSE;
+    fchmodat(stage_fd, e->path, e->mode, 0);
+    set_times_at(stage_fd, e->path, e->mtime_ns);
+    return TRUE;
+}
+
+static void record_error(GError **first_error, GError *error) {
+    g_printerr("%s\n", error->message);
+    if (!*first_error) *first_error = error;
+    else g_error_free(error);
+}
+
+void preset_changes_init(PresetChanges *changes) {
+    changes->added = g_ptr_array_new_with_free_func(g_free);
+    changes->modified = g_ptr_array_new_with_free_func(g_free);
+    changes->removed = g_ptr_array_new_with_free_func(g_free);
+    changes->renamed = g_ptr_array_new_with_free_func(g_free);
+}
+
+void preset_changes_clear(PresetChanges *changes) {
+    g_clear_pointer(&changes->added, g_ptr_array_unref);
+    g_clear_pointer(&changes->modified, g_ptr_array_unref);
+    g_clear_pointer(&changes->removed, g_ptr_array_unref);
+    g_clear_pointer(&changes->renamed, g_ptr_array_unref);
+}
+
+guint preset_changes_count(const PresetChanges *changes) {
+    return changes->added->len + changes->modified->len + changes->removed->len
+           + changes->renamed->len;
+}
+
+static void preset_changes_reset(PresetChanges *changes) {
+    g_ptr_array_set_size(changes->added, 0);
+    g_ptr_array_set_size(changes->modified, 0);
+    g_ptr_array_set_size(changes->removed, 0);
+    g_ptr_array_set_size(changes->renamed, 0);
+}
+
+/* Put stage where dest is in a single rename; the old tree ends up at
+ * stage. Filesystems without RENAME_EXCHANGE get two renames instead. */
+static gboolean exchange_dirs(const char *stage, const char *dest, GError **error) {
+    if (renameat2(AT_FDCWD, stage, AT_FDCWD, dest, RENAME_EXCHANGE) == 0) return TRUE;
+
+    int saved_errno = errno;
+    if (saved_errno == ENOENT && !g_file_test(dest, G_FILE_TEST_EXISTS)) {
+        if (g_rename(stage, dest) == 0) return TRUE;
+        saved_errno = errno;
+    } else if (saved_errno == EINVAL || saved_errno == ENOSYS) {
+        char *aside = g_strconcat(stage, ".old", NULL);
+        gboolean ok = g_rename(dest, aside) == 0;
+        if (ok && g_rename(stage, dest) != 0) {
+            saved_errno = errno;
+            g_rename(aside, dest);
+            ok = FALSE;
+        } else if (ok) {
+            g_rename(aside, stage);
+        } else {
+            saved_errno = errno;
+        }
+        g_free(aside);
+        if (ok) return TRUE;
+    }
+    return set_errno_error(error, saved_errno, "Failed to swap in", dest);
+}
+
+/* Where the tree replaced by the last apply to dest is kept */
+static char *previous_tree_path(const char *dest) {
+    char *parent = g_path_get_dirname(dest);
+    char *base = g_path_get_basename(dest);
+    char *name = g_strdup_printf(".%s-previous", base);
+    char *previous = g_build_filename(parent, name, NULL);
+    g_free(name);
+    g_free(base);
+    g_free(parent);
+    return previous;
+}
+
+/* What is at dest now. Files whose size and mtime match the target take
+ * its hash unread; the others are hashed to tell edits from touches. */
+static GPtrArray *scan_dest(const char *root, const char *dest, int dest_fd, GHashTable *target_by_path,
+                            GCancellable *cancellable, GError **error) {
+    SaveContext scan_ctx = { root, dest };
+    GPtrArray *current = g_ptr_array_new_with_free_func(manifest_entry_free);
+    FileTreePool *pool = file_tree_pool_new(hash_only, &scan_ctx, NULL, cancellable);
+    GError *first_error = NULL;
+    int scan_fd = openat(dest_fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    gboolean ok = scan_fd >= 0
+                      ? scan_tree(scan_fd, NULL, root, target_by_path, current, pool, NULL,
+                                  cancellable, &first_error)
+                      : set_errno_error(&first_error, errno, "Failed to open", dest);
+    GError *pool_error = NULL;
+    if (file_tree_pool_finish(pool, &pool_error) > 0 || pool_error) ok = FALSE;
+    if (pool_error) {
+        if (!first_error) first_error = pool_error;
+        else g_error_free(pool_error);
+    }
+    if (!ok) {
+        g_propagate_error(error, first_error);
+        g_ptr_array_unref(current);
+        return NULL;
+    }
+    return current;
+}
+
+/* Builds the target tree in stage_fd: entries equal to the ones in dest
+ * (or leaving it with the right bytes) are hard links to them, only what
+ * differs is written from the store. Fills changes with how the result
+ * differs from dest. */
+static gboolean stage_entries(const char *root, GPtrArray *target, GPtrArray *current, int dest_fd,
+                              int stage_fd, PresetChanges *changes, gint *progress,
+                              GCancellable *cancellable, GError **error) {
+    GHashTable *target_by_path = g_hash_table_new(g_str_hash, g_str_equal);
+    for (guint i = 0; i < target->len; i++) {
+        ManifestEntry *e = g_ptr_array_index(target, i);
+        g_hash_table_insert(target_by_path, e->path, e);
+    }
+    GHashTable *current_by_path = g_hash_table_new(g_str_hash, g_str_equal);
+    GHashTable *spare_by_hash = g_hash_table_new(g_str_hash, g_str_equal); /* leaving files, by hash */
+    GHashTable *handled = g_hash_table_new(NULL, NULL); /* current entries the stage accounts for */
+    for (guint i = 0; i < current->len; i++) {
+        ManifestEntry *cur = g_ptr_array_index(current, i);
+        g_hash_table_insert(current_by_path, cur->path, cur);
+        if (cur->kind == 'f' && cur->hash && !g_hash_table_contains(target_by_path, cur->path))
+            g_hash_table_insert(spare_by_hash, cur->hash, cur);
+    }
+
+    /* Target order puts every directory before its contents */
+    GError *first_error = NULL;
+    ApplyContext ctx = { root, stage_fd };
+    FileTreePool *pool = file_tree_pool_new(write_file, &ctx, progress, cancellable);
+    for (guint i = 0; i < target->len && !g_cancellable_is_cancelled(cancellable); i++) {
+        ManifestEntry *e = g_ptr_array_index(target, i);
+        ManifestEntry *cur = g_hash_table_lookup(current_by_path, e->path);
+        GError *entry_error = NULL;
+
+        /* one kind replaced by another counts as added */
+        if (cur) g_hash_table_add(handled, cur);
+        if (cur && cur->kind != e->kind) cur = NULL;
+
+        switch (e->kind) {
+        case 'd':
+            /* writable until its contents are in, real mode applied below */
+            if (mkdirat(stage_fd, e->path, 0700) != 0)
+                set_errno_error(&entry_error, errno, "Failed to create", e->path);
+            else if (!cur)
+                g_ptr_array_add(changes->added, g_strdup(e->path));
+            break;
+
+        case 'l':
+            if (symlinkat(e->target, stage_fd, e->path) != 0)
+                set_errno_error(&entry_error, errno, "Failed to link", e->path);
+            else if (!cur || g_strcmp0(cur->target, e->target) != 0)
+                g_ptr_array_add(cur ? changes->modified : changes->added, g_strdup(e->path));
+            break;
+
+        case 'f': {
+            if (cur && g_strcmp0(cur->hash, e->hash) == 0) {
+                if (link_file(dest_fd, e->path, stage_fd, e)) progress_inc(progress);
+                else file_tree_pool_push(pool, e); /* same bytes, just not linkable */
+                break;
+            }
+
+            /* a file that is going away anyway has these bytes: move it */
+            ManifestEntry *spare = g_hash_table_lookup(spare_by_hash, e->hash);
+            if (spare && !g_hash_table_contains(handled, spare)
+                && link_file(dest_fd, spare->path, stage_fd, e)) {
+                g_hash_table_add(handled, spare);
+                g_ptr_array_add(changes->renamed, g_strdup_printf("%s -> %s", spare->path, e->path));
+                progress_inc(progress);
+                break;
+            }
+
+            g_ptr_array_add(cur ? changes->modified : changes->added, g_strdup(e->path));
+            file_tree_pool_push(pool, e);
+            break;
+        }
+        }
+
+        if (entry_error) record_error(&first_error, entry_error);
+    }
+
+    GError *pool_error = NULL;
+    file_tree_pool_finish(pool, &pool_error);
+    if (pool_error) {
+        if (!first_error) first_error = pool_error;
+        else g_error_free(pool_error);
+    }
+
+    /* whatever the target does not have is simply not staged */
+    for (guint i = 0; i < current->len; i++) {
+        ManifestEntry *cur = g_ptr_array_index(current, i);
+        if (!g_hash_table_contains(handled, cur)) g_ptr_array_add(changes->removed, g_strdup(cur->path));
+    }
+
+    for (guint i = target->len; i-- > 0;) {
+        ManifestEntry *e = g_ptr_array_index(target, i);
+        if (e->kind == 'd') fchmodat(stage_fd, e->path, e->mode, 0);
+    }
+
+    g_hash_table_unref(handled);
+    g_hash_table_unref(spare_by_hash);
+    g_hash_table_unref(current_by_path);
+    g_hash_table_unref(target_by_path);
+
+    if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+        g_clear_error(&first_error);
+        return FALSE;
+    }
+    if (first_error) {
+        g_propagate_error(error, first_error);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Directory modes are the one thing an apply with no other change may
+ * still have to fix, in place */
+static void fix_dir_modes(int dest_fd, GPtrArray *target, GPtrArray *current) {
+    GHashTable *current_by_path = g_hash_table_new(g_str_hash, g_str_equal);
+    for (guint i = 0; i < current->len; i++) {
+        ManifestEntry *cur = g_ptr_array_index(current, i);
+        g_hash_table_insert(current_by_path, cur->path, cur);
+    }
+    for (guint i = 0; i < target->len; i++) {
+        ManifestEntry *e = g_ptr_array_index(target, i);
+        ManifestEntry *cur = g_hash_table_lookup(current_by_path, e->path);
+        if (e->kind == 'd' && cur && cur->mode != e->mode) fchmodat(dest_fd, e->path, e->mode, 0);
+    }
+    g_hash_table_unref(current_by_path);
+}
+
+/* Brings the tree at dest in line with a manifest, as a whole; see
+ * preset_store_apply() */
+static gboolean apply_entries(const char *root, GPtrArray *target, const char *dest,
+                              PresetChanges *changes, gint *progress,
+                              GCancellable *cancellable, GError **error) {
+    char *parent = g_path_get_dirname(dest);
+    char *base = g_path_get_basename(dest);
+    char *stage_name = g_strdup_printf(".%s-stage-XXXXXX", base);
+    char *stage = g_build_filename(parent, stage_name, NULL);
+    g_free(stage_name);
+    g_free(base);
+    g_mkdir_with_parents(parent, 0755);
+
+    GHashTable *target_by_path = g_hash_table_new(g_str_hash, g_str_equal);
+    for (guint i = 0; i < target->len; i++) {
+        ManifestEntry *e = g_ptr_array_index(target, i);
+        g_hash_table_insert(target_by_path, e->path, e);
+    }
+
+    /* a dest that does not exist yet is an empty tree */
+    GStatBuf st;
+    gboolean exists = g_stat(dest, &st) == 0;
+    int dest_fd = open(exists ? dest : parent, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    GPtrArray *current = NULL;
+    if (dest_fd < 0)
+        set_errno_error(error, errno, "Failed to open", exists ? dest : parent);
+    else if (exists)
+        current = scan_dest(root, dest, dest_fd, target_by_path, cancellable, error);
+    else
+        current = g_ptr_array_new_with_free_func(manifest_entry_free);
+    g_hash_table_unref(target_by_path);
+    g_free(parent);
+    if (!current) {
+        if (dest_fd >= 0) close(dest_fd);
+        g_free(stage);
+        return FALSE;
+    }
+
+    if (!g_mkdtemp(stage)) {
+        set_errno_error(error, errno, "Failed to create", stage);
+        g_free(stage);
+        g_ptr_array_unref(current);
+        close(dest_fd);
+        return FALSE;
+    }
+    gboolean ok = FALSE;
+    int stage_fd = open(stage, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (stage_fd < 0) set_errno_error(error, errno, "Failed to open", stage);
+    else ok = stage_entries(root, target, current, dest_fd, stage_fd, changes, progress, cancellable, error);
+
+    gboolean swapped = FALSE;
+    if (ok && exists && preset_changes_count(changes) == 0) {
+        /* already applied: leave the tree, and whoever watches it, alone */
+        fix_dir_modes(dest_fd, target, current);
+    } else if (ok) {
+        fchmod(stage_fd, exists ? (st.st_mode & 07777) : 0755);
+        ok = swapped = exchange_dirs(stage, dest, error);
+    }
+
+    if (swapped && exists) {
+        /* stage now holds the tree that was replaced: keep it until the
+         * next apply */
+        char *previous = previous_tree_path(dest);
+        file_tree_remove(previous, NULL, NULL);
+        if (g_rename(stage, previous) != 0) file_tree_remove(stage, NULL, NULL);
+        g_free(previous);
+    } else if (!swapped) {
+        file_tree_remove(stage, NULL, NULL);
+    }
+    if (!ok) preset_changes_reset(changes);
+
+    if (stage_fd >= 0) close(stage_fd);
+    close(dest_fd);
+    g_ptr_array_unref(current);
+    g_free(stage);
+    return ok;
+}
+
+gboolean preset_store_apply(const char *root, const char *name, const char *dest,
+                            PresetChanges *changes, gint *progress,
+                            GCancellable *cancellable, GError **error) {
+    /* Read the target before snapshotting dest, so applying PRESET_STORE_PREVIOUS
+     * restores the state before the last apply rather than the current one */
+    char *path = snapshot_path(root, name, NULL);
+    if (!path) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_NOENT, "Preset %s has no snapshot", name);
+        return FALSE;
+    }
+    GPtrArray *target = load_manifest(path, NULL, error);
+    g_free(path);
+    if (!target) return FALSE;
+
+    /* When dest is a symlink (dotfile managers) the swap happens at its
+     * target, so the link itself survives */
+    char *real = realpath(dest, NULL);
+    char *resolved = g_strdup(real ? real : dest);
+    free(real);
+
+    /* includes snapshotting dest, which is also counted as a save */
+    gint64 span = stats_begin();
+    gboolean ok = TRUE;
+    if (g_file_test(resolved, G_FILE_TEST_IS_DIR))
+        ok = preset_store_save(root, PRESET_STORE_PREVIOUS, resolved, NULL, cancellable, error);
+    if (ok) ok = apply_entries(root, target, resolved, changes, progress, cancellable, error);
+
+    g_ptr_array_unref(target);
+    g_free(resolved);
+    stats_end(STATS_PRESET_APPLY, span);
+    return ok;
+}
+
+/* ------------------------- garbage collection ------------------------ */
+static void collect_referenced(const char *root, GHashTable *referenced) {
+    GDir *dir = g_dir_open(root, 0, NULL);
+    if (!dir) return;
+
+    const char *name;
+    while ((name = g_dir_read_name(dir))) {
+        if (name[0] == '.' && strcmp(name, PRESET_STORE_PREVIOUS) != 0) continue;
+        char *preset_dir = g_build_filename(root, name, NULL);
+        GPtrArray *snapshots = list_snapshots(preset_dir);
+        for (guint i = 0; i < snapshots->len; i++) {
+            char *path = g_build_filename(preset_dir, g_ptr_array_index(snapshots, i), NULL);
+            GPtrArray *entries = load_manifest(path, NULL, NULL);
+            for (guint j = 0; entries && j < entries->len; j++) {
+                ManifestEntry *e = g_ptr_array_index(entries, j);
+                if (e->hash) g_hash_table_add(referenced, g_strdup(e->hash));
+            }
+            if (entries) g_ptr_array_unref(entries);
+            g_free(path);
+        }
+        g_ptr_array_unref(snapshots);
+        g_free(preset_dir);
+    }
+    g_dir_close(dir);
+}
+
+void preset_store_gc(const char *root) {
+    GHashTable *referenced = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    collect_referenced(root, referenced);
+
+    char *objects = g_build_filename(root, OBJECTS_DIR, NULL);
+    GDir *dir = g_dir_open(objects, 0, NULL);
+    const char *prefix;
+    while (dir && (prefix = g_dir_read_name(dir))) {
+        char *sub_path = g_build_filename(objects, prefix, NULL);
+        GDir *sub = g_dir_open(sub_path, 0, NULL);
+        const char *rest;
+        while (sub && (rest = g_dir_read_name(sub))) {
+            char *hash = g_strconcat(prefix, rest, NULL);
+            if (!g_hash_table_contains(referenced, hash)) {
+                char *blob = g_build_filename(sub_path, rest, NULL);
+                g_unlink(blob);
+                g_free(blob);
+            }
+            g_free(hash);
+        }
+        if (sub) g_dir_close(sub);
+        g_rmdir(sub_path); /* only succeeds once empty */
+        g_free(sub_path);
+    }
+    if (dir) g_dir_close(dir);
+
+    g_free(objects);
+    g_hash_table_unref(referenced);
+}
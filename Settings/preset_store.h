@@ -0,0 +1,68 @@
+#ifndef PRESET_STORE_H
+#define PRESET_STORE_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+/* Content-addressed Waybar preset store under root (waybar-presets/):
+ *
+ *   .objects/ab/cdef...          file contents, named by their SHA-256
+ *   <name>/<usec>.manifest       one snapshot of preset <name>
+ *   .previous/<usec>.manifest    the config as it was before each apply
+ *
+ * A manifest lists the tree's directories, symlinks and files (mode, mtime,
+ * size, hash). Saving writes only blobs the store does not have yet and
+ * adds a snapshot when anything changed; the newest snapshot is the preset.
+ * Blobs no manifest references any more are garbage collected.
+ *
+ * progress, when non-NULL, is atomically incremented once per file. */
+
+/* TRUE when <name> has at least one snapshot (FALSE for a legacy plain copy) */
+gboolean preset_store_has_snapshot(const char *root, const char *name);
+
+/* Files in the newest snapshot of <name> */
+gint preset_store_count_files(const char *root, const char *name);
+
+/* Totals of the newest snapshot of <name> and a hash of its contents
+ * (paths and file hashes, not mtimes); FALSE if it has no snapshot */
+gboolean preset_store_describe(const char *root, const char *name, gint64 *size, gint *files,
+                               char **content_hash);
+
+/* Snapshot the tree at src as <name> */
+gboolean preset_store_save(const char *root, const char *name, const char *src,
+                           gint *progress, GCancellable *cancellable, GError **error);
+
+/* Snapshot that preset_store_apply() takes of dest before changing it */
+#define PRESET_STORE_PREVIOUS ".previous"
+
+/* Relative paths touched by an apply; renamed entries read "old -> new" */
+typedef struct {
+    GPtrArray *added;
+    GPtrArray *modified;
+    GPtrArray *removed;
+    GPtrArray *renamed;
+} PresetChanges;
+
+void preset_changes_init(PresetChanges *changes);
+void preset_changes_clear(PresetChanges *changes);
+guint preset_changes_count(const PresetChanges *changes);
+
+/* Make dest match the newest snapshot of <name>, comparing by size, mtime
+ * and hash. The result is staged next to dest: files that stay, or move,
+ * are hard links to the ones in dest and only what differs is written.
+ * The stage is then swapped in with one renameat2(RENAME_EXCHANGE), so
+ * readers see the old tree or the new one, never a mix; nothing is
+ * swapped when nothing differs. The replaced tree is kept next to dest as
+ * .<dest name>-previous until the next apply, and dest's state is also
+ * snapshotted as PRESET_STORE_PREVIOUS first, so applying that preset
+ * undoes the last apply. A symlinked dest is swapped at its target. A
+ * failed or cancelled apply leaves dest untouched and reports the first
+ * error. */
+gboolean preset_store_apply(const char *root, const char *name, const char *dest,
+                            PresetChanges *changes, gint *progress,
+                            GCancellable *cancellable, GError **error);
+
+/* Drop blobs that no snapshot of any preset refers to */
+void preset_store_gc(const char *root);
+
+#endif // PRESET_STORE_H
@@ -0,0 +1,1126 @@
+/* settings-bench: times the settings-core hot paths on synthetic input and
+ * prints the results as one JSON document, so runs can be diffed for
+ * regressions.
+ *
+ *   parse    parse_keybinds() of a generated keybinds.conf
+ *   rewrite  rewrite_config() of that model to a scratch file
+ *   cache    keybinds_cache_load() of that model's snapshot, the launch path
+ *            for an unchanged config; compare with parse at the same size
+ *   save     preset_store_save() of a generated Waybar tree into an empty store
+ *   copy     preset_store_apply() of that preset into an empty directory
+ *   apply    preset_store_apply() after 1% of the applied files were edited
+ *   churn    edit/search cycles on a loaded model, each also walking the
+ *            list view's rows for the edit and refreshing the presets
+ *            list; fails the run when RSS or outstanding allocations keep
+ *            growing
+ *   live     an edit written and pushed to a mock Hyprland transport; fails
+ *            the run unless it arrives as keywords with autoreload off, and
+ *            nothing but the option query is sent with it on
+ *   ipc      hypr_ipc_run() of a batch too large for one request, over the
+ *            real socket transport to a mock server on a temporary
+ *            $XDG_RUNTIME_DIR/hypr/<sig>/.socket.sock; fails the run unless
+ *            every command arrives once, in order, no request overflows
+ *            Hyprland's buffer, errors name their command and a silent
+ *            server times out
+ *   flush    keybinds_save_flush() of an edit while another section was
+ *            edited on disk, as on quit; fails the run unless both edits
+ *            end up in the file, or if an edit to the same section is
+ *            not reported as failed
+ *   reload   waybar_reload_async() against two dummy bars, one named like a
+ *            wrapped launch, until both have handled SIGUSR2; fails the
+ *            run unless both are signalled and the script is never run
+ */
+#include "keybinds_model.h"
+#include "keybinds_cache.h"
+#include "keybind_list.h"
+#include "keybind_search.h"
+#include "keybinds_live.h"
+#include "hypr_ipc.h"
+#include "waybar_reload.h"
+#include "preset_store.h"
+#include "preset_index.h"
+#include "file_tree.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <glib/gstdio.h>
+
+#define DEFAULT_SIZES "1000,10000,100000,1000000"
+#define DEFAULT_FILES 500
+#define FILES_PER_DIR 25
+#define LINES_PER_SECTION 50
+#define MIN_ITERATIONS 5
+#define MAX_ITERATIONS 10000
+#define DEFAULT_CHURN 100000
+#define CHURN_LINES 2000
+/* How far RSS and live allocations may drift once warm */
+#define CHURN_MAX_RSS_GROWTH (1024 * 1024)
+#define CHURN_MAX_ALLOC_GROWTH 256
+
+/* ------------------------- allocation counting ------------------------ */
+/* glibc lets the executable interpose malloc for every library it loads,
+ * GLib included; elsewhere allocations are reported as null */
+#ifdef __GLIBC__
+#define HAVE_ALLOC_COUNT 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void *__libc_valloc(size_t size);
+extern void *__libc_pvalloc(size_t size);
+extern void __libc_free(void *ptr);
+
+static gint64 g_allocs = 0;
+static gint64 g_live = 0;  /* blocks allocated and not yet freed */
+
+static inline void count_alloc(void) {
+    __atomic_add_fetch(&g_allocs, 1, __ATOMIC_RELAXED);
+}
+
+static inline void count_live(gint64 delta) {
+    __atomic_add_fetch(&g_live, delta, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size) {
+    count_alloc();
+    void *p = __libc_malloc(size);
+    if (p) count_live(1);
+    return p;
+}
+
+void *calloc(size_t n, size_t size) {
+    count_alloc();
+    void *p = __libc_calloc(n, size);
+    if (p) count_live(1);
+    return p;
+}
+
+void *realloc(void *ptr, size_t size) {
+    count_alloc();
+    void *p = __libc_realloc(ptr, size);
+    if (!ptr && p) count_live(1);
+    else if (ptr && size == 0) count_live(-1);
+    return p;
+}
+
+/* The aligned ones too: their blocks come back through free() */
+static void *counted(void *p) {
+    count_alloc();
+    if (p) count_live(1);
+    return p;
+}
+
+void *memalign(size_t alignment, size_t size) {
+    return counted(__libc_memalign(alignment, size));
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    return counted(__libc_memalign(alignment, size));
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size) {
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+    void *p = counted(__libc_memalign(alignment, size));
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+void *valloc(size_t size) {
+    return counted(__libc_valloc(size));
+}
+
+void *pvalloc(size_t size) {
+    return counted(__libc_pvalloc(size));
+}
+
+void free(void *ptr) {
+    if (ptr) count_live(-1);
+    __libc_free(ptr);
+}
+
+static gint64 alloc_count(void) {
+    return __atomic_load_n(&g_allocs, __ATOMIC_RELAXED);
+}
+
+static gint64 live_count(void) {
+    return __atomic_load_n(&g_live, __ATOMIC_RELAXED);
+}
+#else
+static gint64 alloc_count(void) {
+    return 0;
+}
+
+static gint64 live_count(void) {
+    return 0;
+}
+#endif
+
+/* ------------------------- timing ------------------------ */
+static gint64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (gint64)ts.tv_sec * G_GINT64_CONSTANT(1000000000) + ts.tv_nsec;
+}
+
+typedef void (*BenchStep)(gpointer data);
+
+typedef struct {
+    const char *name;
+    const char *unit; /* what size counts: "lines" or "files" */
+    gint64 size;
+    gint64 bytes;     /* input bytes processed per iteration */
+    BenchStep setup;  /* untimed, before each iteration; may be NULL */
+    BenchStep body;
+    gpointer data;
+} Bench;
+
+static double opt_min_time = 1.0;
+static gint opt_iterations = 0;
+static char *opt_sizes = NULL;
+static gint opt_files = DEFAULT_FILES;
+static char *opt_only = NULL;
+static gboolean opt_durable = FALSE;
+static gint opt_churn = DEFAULT_CHURN;
+
+static int compare_gint64(gconstpointer a, gconstpointer b) {
+    gint64 x = *(const gint64 *)a, y = *(const gint64 *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Nearest-rank percentile of sorted samples */
+static gint64 percentile(GArray *sorted, double q) {
+    guint rank = (guint)(q * sorted->len + 0.999999);
+    return g_array_index(sorted, gint64, CLAMP(rank, 1, sorted->len) - 1);
+}
+
+static void append_json_ms(GString *out, const char *key, gint64 ns) {
+    char buf[G_ASCII_DTOSTR_BUF_SIZE];
+    g_string_append_printf(out, ", \"%s\": %s", key, g_ascii_formatd(buf, sizeof(buf), "%.4f", ns / 1e6));
+}
+
+static void append_json_rate(GString *out, const char *key, double value) {
+    char buf[G_ASCII_DTOSTR_BUF_SIZE];
+    g_string_append_printf(out, ", \"%s\": %s", key, g_ascii_formatd(buf, sizeof(buf), "%.1f", value));
+}
+
+static void run_bench(GString *out, const Bench *bench) {
+    if (opt_only && !strstr(opt_only, bench->name)) return;
+
+    GArray *samples = g_array_new(FALSE, FALSE, sizeof(gint64));
+    gint64 total_ns = 0, allocs = 0;
+    gint64 min_ns = (gint64)(opt_min_time * 1e9);
+
+    for (;;) {
+        if (opt_iterations > 0 && (gint)samples->len >= opt_iterations) break;
+        if (opt_iterations <= 0 && samples->len >= MIN_ITERATIONS
+            && (total_ns >= min_ns || samples->len >= MAX_ITERATIONS))
+            break;
+
+        if (bench->setup) bench->setup(bench->data);
+        gint64 allocs_before = alloc_count();
+        gint64 start = now_ns();
+        bench->body(bench->data);
+        gint64 elapsed = now_ns() - start;
+        allocs += alloc_count() - allocs_before;
+
+        g_array_append_val(samples, elapsed);
+        total_ns += elapsed;
+    }
+
+    gint64 mean_ns = total_ns / samples->len;
+    g_array_sort(samples, compare_gint64);
+    double seconds = MAX(mean_ns, 1) / 1e9;
+
+    if (out->str[out->len - 1] == '}') g_string_append(out, ",");
+    g_string_append_printf(out, "\n    { \"name\": \"%s\", \"unit\": \"%s\", \"size\": %" G_GINT64_FORMAT
+                           ", \"bytes\": %" G_GINT64_FORMAT ", \"iterations\": %u",
+                           bench->name, bench->unit, bench->size, bench->bytes, samples->len);
+    append_json_ms(out, "mean_ms", mean_ns);
+    append_json_ms(out, "p50_ms", percentile(samples, 0.50));
+    append_json_ms(out, "p99_ms", percentile(samples, 0.99));
+    append_json_rate(out, "items_per_sec", bench->size / seconds);
+    append_json_rate(out, "mb_per_sec", bench->bytes / seconds / (1024.0 * 1024.0));
+#ifdef HAVE_ALLOC_COUNT
+    append_json_rate(out, "allocs_per_iter", (double)allocs / samples->len);
+#else
+    g_string_append(out, ", \"allocs_per_iter\": null");
+#endif
+    g_string_append(out, " }");
+
+    g_printerr("%-8s %8" G_GINT64_FORMAT " %-5s p50 %10.3f ms  p99 %10.3f ms\n", bench->name,
+               bench->size, bench->unit, percentile(samples, 0.50) / 1e6,
+               percentile(samples, 0.99) / 1e6);
+    g_array_unref(samples);
+}
+
+/* ------------------------- synthetic input ------------------------ */
+static const char *const bind_keys[] = { "Q", "W", "E", "R", "T", "A", "S", "D", "F", "G",
+                                         "1", "2", "3", "4", "5", "Return", "Space", "Tab",
+                                         "mouse:272", "XF86AudioRaiseVolume" };
+static const char *const bind_mods[] = { "$mainMod", "$mainMod SHIFT", "$mainMod CTRL", "ALT",
+                                         "SUPER ALT", "" };
+static const char *const bind_kinds[] = { "bind", "bindel", "bindm", "bindl", "bindr" };
+
+static gint64 write_keybinds(const char *path, gint64 lines) {
+    GString *buf = g_string_sized_new(lines * 48);
+    g_string_append(buf, "# generated by settings-bench\n$mainMod = SUPER\n$terminal = kitty\n\n");
+
+    GRand *rand = g_rand_new_with_seed(lines);
+    for (gint64 i = 0; i < lines; i++) {
+        if (i % LINES_PER_SECTION == 0) {
+            g_string_append_printf(buf, "## Section %" G_GINT64_FORMAT "\n", i / LINES_PER_SECTION);
+            continue;
+        }
+        guint32 r = g_rand_int(rand);
+        if (r % 16 == 0) {
+            g_string_append_printf(buf, "# note %u\n", r);
+            continue;
+        }
+        g_string_append_printf(buf, "%s = %s, %s, exec, command-%" G_GINT64_FORMAT " --flag %u\n",
+                               bind_kinds[r % G_N_ELEMENTS(bind_kinds)],
+                               bind_mods[(r >> 8) % G_N_ELEMENTS(bind_mods)],
+                               bind_keys[(r >> 16) % G_N_ELEMENTS(bind_keys)], i, r);
+    }
+    g_rand_free(rand);
+
+    GError *error = NULL;
+    if (!g_file_set_contents(path, buf->str, buf->len, &error)) {
+        g_printerr("Failed to write %s: %s\n", path, error->message);
+        exit(1);
+    }
+    gint64 bytes = buf->len;
+    g_string_free(buf, TRUE);
+    return bytes;
+}
+
+/* Waybar-like tree: mostly small config and style files, a few larger ones */
+static gint64 write_tree(const char *root, gint files) {
+    GRand *rand = g_rand_new_with_seed(files);
+    gint64 bytes = 0;
+    for (gint i = 0; i < files; i++) {
+        char *dir = g_strdup_printf("%s/modules-%02d", root, i / FILES_PER_DIR);
+        char *path = g_strdup_printf("%s/file-%04d.%s", dir, i, i % 3 ? "jsonc" : "css");
+        g_mkdir_with_parents(dir, 0755);
+
+        gsize len = i % 50 == 0 ? 256 * 1024 : g_rand_int_range(rand, 256, 16 * 1024);
+        char *data = g_malloc(len);
+        for (gsize j = 0; j < len; j++) data[j] = "abcdefghij {}:;,\n"[g_rand_int_range(rand, 0, 17)];
+        if (!g_file_set_contents(path, data, len, NULL)) {
+            g_printerr("Failed to write %s\n", path);
+            exit(1);
+        }
+        bytes += len;
+
+        g_free(data);
+        g_free(path);
+        g_free(dir);
+    }
+    g_rand_free(rand);
+    return bytes;
+}
+
+/* ------------------------- benchmarks ------------------------ */
+typedef struct {
+    char *conf;
+    char *out;
+} KeybindsBench;
+
+static void bench_parse(gpointer data) {
+    KeybindsBench *kb = data;
+    int count = 0;
+    Section *sections = parse_keybinds(kb->conf, &count);
+    if (!sections) exit(1);
+    g_sections = sections;
+    g_section_count = count;
+}
+
+static void bench_cache(gpointer data) {
+    KeybindsBench *kb = data;
+    int count = 0;
+    Section *sections = keybinds_cache_load(kb->conf, &count);
+    if (!sections) {
+        g_printerr("cache: the snapshot of %s was not used\n", kb->conf);
+        exit(1);
+    }
+    g_sections = sections;
+    g_section_count = count;
+}
+
+static void bench_rewrite(gpointer data) {
+    KeybindsBench *kb = data;
+    if (!rewrite_config(kb->out, g_sections, g_section_count)) exit(1);
+}
+
+typedef struct {
+    char *src;   /* generated tree */
+    char *root;  /* preset store */
+    char *dest;  /* applied copy */
+    gint files;
+    guint edits; /* files edited before each apply */
+    guint round;
+} PresetBench;
+
+static void check(gboolean ok, GError *error) {
+    if (ok) return;
+    g_printerr("%s\n", error ? error->message : "failed");
+    exit(1);
+}
+
+static void reset_store(gpointer data) {
+    PresetBench *pb = data;
+    file_tree_remove(pb->root, NULL, NULL);
+}
+
+static void bench_save(gpointer data) {
+    PresetBench *pb = data;
+    GError *error = NULL;
+    check(preset_store_save(pb->root, "bench", pb->src, NULL, NULL, &error), error);
+}
+
+static void reset_dest(gpointer data) {
+    PresetBench *pb = data;
+    file_tree_remove(pb->dest, NULL, NULL);
+}
+
+static void bench_apply(gpointer data) {
+    PresetBench *pb = data;
+    PresetChanges changes;
+    GError *error = NULL;
+    preset_changes_init(&changes);
+    check(preset_store_apply(pb->root, "bench", pb->dest, &changes, NULL, NULL, &error), error);
+    preset_changes_clear(&changes);
+}
+
+/* Edit a different 1% of the applied files each round */
+static void edit_dest(gpointer data) {
+    PresetBench *pb = data;
+    for (guint i = 0; i < pb->edits; i++) {
+        gint n = (pb->round * pb->edits + i) % pb->files;
+        char *path = g_strdup_printf("%s/modules-%02d/file-%04d.%s", pb->dest, n / FILES_PER_DIR, n,
+                                     n % 3 ? "jsonc" : "css");
+        char *text = g_strdup_printf("/* edited in round %u */\n", pb->round);
+        g_file_set_contents(path, text, -1, NULL);
+        g_free(text);
+        g_free(path);
+    }
+    pb->round++;
+}
+
+/* ------------------------- churn ------------------------ */
+static gint64 rss_bytes(void) {
+    gchar *statm = NULL;
+    gint64 pages = 0;
+    if (g_file_get_contents("/proc/self/statm", &statm, NULL, NULL)) {
+        char **fields = g_strsplit(statm, " ", 3);
+        if (fields[0] && fields[1]) pages = g_ascii_strtoll(fields[1], NULL, 10);
+        g_strfreev(fields);
+        g_free(statm);
+    }
+    return pages * sysconf(_SC_PAGESIZE);
+}
+
+#define CHURN_VISIBLE_ROWS 40
+#define CHURN_PRESETS 8
+
+typedef struct {
+    KbBindList *list;
+    char *presets;  /* preset store the presets tab lists */
+} Churn;
+
+/* What GtkListView does after items-changed: fetch the items of the rows
+ * on screen around the edit, bind them, drop them when they scroll away */
+static void walk_rows(KbBindList *list, guint around) {
+    guint n = g_list_model_get_n_items(G_LIST_MODEL(list));
+    guint first = around > CHURN_VISIBLE_ROWS / 2 ? around - CHURN_VISIBLE_ROWS / 2 : 0;
+    for (guint pos = first; pos < MIN(n, first + CHURN_VISIBLE_ROWS); pos++) {
+        KbBindItem *item = g_list_model_get_item(G_LIST_MODEL(list), pos);
+        kb_bind_item_get_row(item);
+        g_object_unref(item);
+    }
+}
+
+/* One edit the way the window makes it: replace a bind and let the list
+ * rebind its rows, re-run the search the list is filtered by, trim as the
+ * write-behind would; and the presets tab refreshing its list */
+static void churn_cycle(Churn *churn, guint i) {
+    int s = i % g_section_count;
+    if (g_sections[s].binds->len == 0) return;
+    char *text = g_strdup_printf("bind = SUPER, %s, exec, churn-%u", bind_keys[i % G_N_ELEMENTS(bind_keys)], i);
+    model_replace_bind(s, 0, text);
+    g_free(text);
+    kb_bind_list_row_changed(churn->list, s, 0);
+    walk_rows(churn->list, s * LINES_PER_SECTION);
+
+    guint hits = search_query("churn exec");
+    GArray *rows = g_array_sized_new(FALSE, FALSE, sizeof(KbRowRef), hits);
+    for (int k = 0; k < g_section_count && rows->len < hits; k++) {
+        GArray *binds = g_sections[k].binds;
+        for (guint j = 0; j < binds->len; j++) {
+            if (!search_score(g_array_index(binds, Keybind, j).id)) continue;
+            KbRowRef ref = { k, j };
+            g_array_append_val(rows, ref);
+        }
+    }
+    kb_bind_list_set_filter(churn->list, rows);
+    walk_rows(churn->list, 0);
+    g_array_unref(rows);
+    kb_bind_list_set_filter(churn->list, NULL);
+
+    keybinds_trim();
+
+    GPtrArray *presets = preset_index_list(churn->presets);
+    g_ptr_array_unref(presets);
+}
+
+/* A few small presets, one of them applied, for the presets list */
+static char *write_churn_presets(const char *tmp) {
+    char *src = g_build_filename(tmp, "churn-waybar", NULL);
+    char *root = g_build_filename(tmp, "churn-presets", NULL);
+    write_tree(src, FILES_PER_DIR);
+    for (int i = 0; i < CHURN_PRESETS; i++) {
+        char *name = g_strdup_printf("preset-%d", i);
+        GError *error = NULL;
+        check(preset_store_save(root, name, src, NULL, NULL, &error), error);
+        g_free(name);
+    }
+    preset_index_mark_applied(root, "preset-0");
+    g_free(src);
+    return root;
+}
+
+/* Warms up for a tenth of the cycles (arenas, index and hash tables reach
+ * their working size), then runs the rest and compares */
+static gboolean run_churn(GString *out, KeybindsBench *kb, const char *tmp) {
+    if (opt_only && !strstr(opt_only, "churn")) return TRUE;
+    if (opt_churn <= 0) return TRUE;
+
+    write_keybinds(kb->conf, CHURN_LINES);
+    bench_parse(kb);
+    Churn churn = { kb_bind_list_new(), write_churn_presets(tmp) };
+    guint warmup = MAX(opt_churn / 10, 1);
+    for (guint i = 0; i < warmup; i++) churn_cycle(&churn, i);
+
+    gint64 rss_before = rss_bytes(), live_before = live_count();
+    gint64 start = now_ns();
+    for (guint i = warmup; i < (guint)opt_churn; i++) churn_cycle(&churn, i);
+    gint64 elapsed = now_ns() - start;
+    gint64 rss_growth = rss_bytes() - rss_before, live_growth = live_count() - live_before;
+    g_object_unref(churn.list);
+    g_free(churn.presets);
+    free_keybinds();
+
+    gboolean flat = rss_growth <= CHURN_MAX_RSS_GROWTH && live_growth <= CHURN_MAX_ALLOC_GROWTH;
+    guint cycles = opt_churn - warmup;
+    if (out->str[out->len - 1] == '}') g_string_append(out, ",");
+    g_string_append_printf(out, "\n    { \"name\": \"churn\", \"unit\": \"cycles\", \"size\": %u", cycles);
+    append_json_ms(out, "mean_ms", elapsed / MAX(cycles, 1));
+    g_string_append_printf(out, ", \"rss_growth_bytes\": %" G_GINT64_FORMAT, rss_growth);
+#ifdef HAVE_ALLOC_COUNT
+    g_string_append_printf(out, ", \"live_allocs_growth\": %" G_GINT64_FORMAT, live_growth);
+#else
+    g_string_append(out, ", \"live_allocs_growth\": null");
+#endif
+    g_string_append_printf(out, ", \"flat\": %s }", flat ? "true" : "false");
+
+    g_printerr("%-8s %8u %-5s rss %+" G_GINT64_FORMAT " KiB  live allocs %+" G_GINT64_FORMAT "%s\n", "churn",
+               cycles, "edits", rss_growth / 1024, live_growth, flat ? "" : "  GROWING");
+    return flat;
+}
+
+/* ------------------------- live apply ------------------------ */
+/* Hyprland's side of the request socket, as a HyprIpcTransport: answers
+ * the autoreload query and every batched command, "ok" unless the
+ * command names a bogus keyword */
+typedef struct {
+    gboolean autoreload;
+    GPtrArray *requests;  /* everything received, in order */
+} MockHyprland;
+
+#define BATCH_PREFIX "[[BATCH]]"
+#define BOGUS_KEYWORD "keyword bogus"
+
+static char *mock_request(gpointer data, const char *request, GError **error) {
+    MockHyprland *mock = data;
+    g_ptr_array_add(mock->requests, g_strdup(request));
+    if (g_str_has_prefix(request, "j/getoption "))
+        return g_strdup_printf("{\"option\": \"%s\", \"int\": %d, \"set\": true}",
+                               request + strlen("j/getoption "), !mock->autoreload);
+
+    if (!g_str_has_prefix(request, BATCH_PREFIX))
+        return g_strdup(g_str_has_prefix(request, BOGUS_KEYWORD) ? "invalid field" : "ok");
+
+    GString *reply = g_string_new(NULL);
+    char **commands = g_strsplit(request + strlen(BATCH_PREFIX), ";", -1);
+    for (char **c = commands; *c; c++)
+        g_string_append(reply, g_str_has_prefix(*c, BOGUS_KEYWORD) ? "invalid field\n\n" : "ok\n\n");
+    g_strfreev(commands);
+    return g_string_free(reply, FALSE);
+}
+
+/* Requests that contain needle; an edit's keywords may take several */
+static guint count_requests(MockHyprland *mock, const char *needle) {
+    guint n = 0;
+    for (guint i = 0; i < mock->requests->len; i++)
+        n += strstr(g_ptr_array_index(mock->requests, i), needle) != NULL;
+    return n;
+}
+
+typedef struct {
+    KeybindsBench *kb;
+    guint round;
+} LiveBench;
+
+/* One edit to a bind, written the way the write-behind writes it, which
+ * hands the delta to the live apply handler */
+static void bench_live(gpointer data) {
+    LiveBench *lb = data;
+    int s = lb->round % g_section_count;
+    GArray *binds = g_sections[s].binds;
+    guint row = 0;
+    while (row < binds->len && !keybind_is_bind(&g_array_index(binds, Keybind, row))) row++;
+    if (row == binds->len) row = 0;
+
+    char *text = g_strdup_printf("bind = SUPER ALT, %s, exec, live-%u", bind_keys[lb->round % G_N_ELEMENTS(bind_keys)],
+                                 lb->round);
+    model_replace_bind(s, row, text);
+    g_free(text);
+    lb->round++;
+    if (!rewrite_config(lb->kb->conf, g_sections, g_section_count)) exit(1);
+}
+
+static gboolean run_live(GString *out, KeybindsBench *kb) {
+    if (opt_only && !strstr(opt_only, "live")) return TRUE;
+
+    gint64 bytes = write_keybinds(kb->conf, CHURN_LINES);
+    bench_parse(kb);
+    MockHyprland mock = { FALSE, g_ptr_array_new_with_free_func(g_free) };
+    HyprIpcTransport transport = { mock_request, &mock };
+    hypr_ipc_set_transport(&transport);
+
+    /* autoreload off: keywords only, the option asked once */
+    LiveBench lb = { kb, 0 };
+    keybinds_live_enable();
+    Bench live = { "live", "edits", 1, bytes, NULL, bench_live, &lb };
+    run_bench(out, &live);
+    gboolean ok = count_requests(&mock, "getoption") == 1 && count_requests(&mock, "keyword unbind") >= lb.round
+                  && count_requests(&mock, "keyword ") + 1 == mock.requests->len;
+    if (!ok) g_printerr("live: with autoreload off, edits did not arrive as keywords only\n");
+
+    /* autoreload on: Hyprland re-reads the file, nothing else is sent */
+    mock.autoreload = TRUE;
+    g_ptr_array_set_size(mock.requests, 0);
+    keybinds_live_enable();
+    for (guint i = 0; i < MIN_ITERATIONS; i++) bench_live(&lb);
+    if (mock.requests->len != 1 || count_requests(&mock, "getoption") != 1) {
+        g_printerr("live: with autoreload on, %u request(s) were sent besides the option query\n",
+                   mock.requests->len - MIN(mock.requests->len, 1));
+        ok = FALSE;
+    }
+
+    keybinds_set_live_apply_handler(NULL);
+    hypr_ipc_set_transport(NULL);
+    g_ptr_array_unref(mock.requests);
+    free_keybinds();
+    return ok;
+}
+
+/* ------------------------- hyprland socket ------------------------ */
+/* Hyprland reads each request with one read() into a buffer this size */
+#define HYPRLAND_BUFFER 8192
+#define IPC_COMMANDS 1000  /* ~30 KiB of keywords: several batches */
+
+/* A GSocketService on the path hypr_ipc_socket_path() computes, answering
+ * like MockHyprland. It runs on its own thread and main context, since
+ * the socket transport blocks the calling one. */
+typedef struct {
+    char *path;
+    GMainContext *context;
+    GMainLoop *loop;
+    GThread *thread;
+    GSocketService *service;
+    GMutex lock;
+    MockHyprland mock;
+    gboolean overflow;  /* a request filled Hyprland's whole buffer */
+    gboolean silent;    /* accept, never answer */
+    GPtrArray *held;    /* connections left unanswered */
+} MockServer;
+
+static gboolean on_mock_connection(GSocketService *service, GSocketConnection *conn, GObject *source_object,
+                                   gpointer user_data) {
+    MockServer *server = user_data;
+    if (g_atomic_int_get(&server->silent)) {
+        g_ptr_array_add(server->held, g_object_ref(conn));
+        return TRUE;
+    }
+
+    char buf[HYPRLAND_BUFFER];
+    gssize n = g_input_stream_read(g_io_stream_get_input_stream(G_IO_STREAM(conn)), buf, sizeof(buf), NULL, NULL);
+    if (n <= 0) return TRUE;
+    char *request = g_strndup(buf, n);
+    g_mutex_lock(&server->lock);
+    if (n == sizeof(buf)) server->overflow = TRUE;
+    char *reply = mock_request(&server->mock, request, NULL);
+    g_mutex_unlock(&server->lock);
+
+    g_output_stream_write_all(g_io_stream_get_output_stream(G_IO_STREAM(conn)), reply, strlen(reply), NULL,
+                              NULL, NULL);
+    g_io_stream_close(G_IO_STREAM(conn), NULL, NULL);
+    g_free(reply);
+    g_free(request);
+    return TRUE;
+}
+
+static gpointer serve_mock(gpointer data) {
+    MockServer *server = data;
+    g_main_context_push_thread_default(server->context);
+    g_main_loop_run(server->loop);
+    g_main_context_pop_thread_default(server->context);
+    return NULL;
+}
+
+/* Listens before returning, so the first request cannot miss it */
+static void mock_server_start(MockServer *server, const char *path) {
+    GError *error = NULL;
+    server->path = g_strdup(path);
+    char *dir = g_path_get_dirname(path);
+    g_mkdir_with_parents(dir, 0700);
+    g_free(dir);
+    g_mutex_init(&server->lock);
+    server->mock.requests = g_ptr_array_new_with_free_func(g_free);
+    server->held = g_ptr_array_new_with_free_func(g_object_unref);
+    server->context = g_main_context_new();
+    server->loop = g_main_loop_new(server->context, FALSE);
+
+    /* the service accepts on the thread-default context it is set up in */
+    g_main_context_push_thread_default(server->context);
+    server->service = g_socket_service_new();
+    GSocketAddress *address = g_unix_socket_address_new(path);
+    check(g_socket_listener_add_address(G_SOCKET_LISTENER(server->service), address, G_SOCKET_TYPE_STREAM,
+                                        G_SOCKET_PROTOCOL_DEFAULT, NULL, NULL, &error),
+          error);
+    g_object_unref(address);
+    g_signal_connect(server->service, "incoming", G_CALLBACK(on_mock_connection), server);
+    g_socket_service_start(server->service);
+    g_main_context_pop_thread_default(server->context);
+    server->thread = g_thread_new("mock-hyprland", serve_mock, server);
+}
+
+static void mock_server_stop(MockServer *server) {
+    g_socket_service_stop(server->service);
+    g_socket_listener_close(G_SOCKET_LISTENER(server->service));
+    g_main_loop_quit(server->loop);
+    g_thread_join(server->thread);
+    g_object_unref(server->service);
+    g_ptr_array_unref(server->held);
+    g_main_loop_unref(server->loop);
+    g_main_context_unref(server->context);
+    g_ptr_array_unref(server->mock.requests);
+    g_mutex_clear(&server->lock);
+    g_unlink(server->path);
+    g_free(server->path);
+}
+
+typedef struct {
+    GPtrArray *commands;
+    GError *error;
+} IpcBench;
+
+static void bench_ipc(gpointer data) {
+    IpcBench *ib = data;
+    if (!ib->error) hypr_ipc_run(ib->commands, &ib->error);
+}
+
+/* The commands as received, batches split again; NULL on a request that
+ * is neither a batch nor a lone command with a ';' */
+static GPtrArray *received_commands(GPtrArray *requests) {
+    GPtrArray *received = g_ptr_array_new_with_free_func(g_free);
+    for (guint i = 0; i < requests->len; i++) {
+        const char *request = g_ptr_array_index(requests, i);
+        if (!g_str_has_prefix(request, BATCH_PREFIX)) {
+            g_ptr_array_add(received, g_strdup(request));
+            continue;
+        }
+        char **commands = g_strsplit(request + strlen(BATCH_PREFIX), ";", -1);
+        for (char **c = commands; *c; c++) g_ptr_array_add(received, g_strdup(*c));
+        g_strfreev(commands);
+    }
+    return received;
+}
+
+static gboolean same_commands(GPtrArray *a, GPtrArray *b) {
+    if (a->len != b->len) return FALSE;
+    for (guint i = 0; i < a->len; i++)
+        if (strcmp(g_ptr_array_index(a, i), g_ptr_array_index(b, i)) != 0) return FALSE;
+    return TRUE;
+}
+
+static gboolean run_ipc(GString *out) {
+    if (opt_only && !strstr(opt_only, "ipc")) return TRUE;
+
+    char *signature = g_strdup_printf("settings-bench-%d", (int)getpid());
+    char *old_signature = g_strdup(g_getenv("HYPRLAND_INSTANCE_SIGNATURE"));
+    g_setenv("HYPRLAND_INSTANCE_SIGNATURE", signature, TRUE);
+    char *path = hypr_ipc_socket_path();
+    MockServer server = { NULL };
+    mock_server_start(&server, path);
+    hypr_ipc_set_transport(NULL);
+
+    /* keywords filling more than one request, and one that has to go alone */
+    IpcBench ib = { g_ptr_array_new_with_free_func(g_free), NULL };
+    gint64 bytes = 0;
+    for (guint i = 0; i < IPC_COMMANDS; i++) {
+        char *command = i == IPC_COMMANDS / 2 ? g_strdup("keyword bind SUPER, X, exec, notify-send a; notify-send b")
+                                              : g_strdup_printf("keyword unbind SUPER ALT, %s, %u",
+                                                                bind_keys[i % G_N_ELEMENTS(bind_keys)], i);
+        bytes += strlen(command) + 1;
+        g_ptr_array_add(ib.commands, command);
+    }
+    gboolean ok = hypr_ipc_available();
+    if (!ok) g_printerr("ipc: %s is not there to connect to\n", path);
+
+    Bench ipc = { "ipc", "commands", IPC_COMMANDS, bytes, NULL, bench_ipc, &ib };
+    run_bench(out, &ipc);
+    if (ib.error) {
+        g_printerr("ipc: %s\n", ib.error->message);
+        g_clear_error(&ib.error);
+        ok = FALSE;
+    }
+
+    /* one more run, checked request by request */
+    g_mutex_lock(&server.lock);
+    g_ptr_array_set_size(server.mock.requests, 0);
+    g_mutex_unlock(&server.lock);
+    if (!hypr_ipc_run(ib.commands, &ib.error)) {
+        g_printerr("ipc: %s\n", ib.error->message);
+        g_clear_error(&ib.error);
+        ok = FALSE;
+    }
+    g_mutex_lock(&server.lock);
+    GPtrArray *received = received_commands(server.mock.requests);
+    guint requests = server.mock.requests->len;
+    gboolean overflow = server.overflow;
+    g_mutex_unlock(&server.lock);
+    /* the lone command splits the batches in two, each too big for one
+     * request */
+    if (!same_commands(received, ib.commands) || requests < 5 || overflow) {
+        g_printerr("ipc: %u commands arrived in %u request(s)%s, %u were sent\n", received->len, requests,
+                   overflow ? ", one filling Hyprland's buffer" : "", ib.commands->len);
+        ok = FALSE;
+    }
+    g_ptr_array_unref(received);
+
+    /* a reply other than "ok" fails the run, naming its command */
+    g_ptr_array_insert(ib.commands, 1, g_strdup(BOGUS_KEYWORD " 1"));
+    if (hypr_ipc_run(ib.commands, &ib.error) || !ib.error || !strstr(ib.error->message, BOGUS_KEYWORD)) {
+        g_printerr("ipc: a failed command was not reported as such\n");
+        ok = FALSE;
+    }
+    g_clear_error(&ib.error);
+
+    /* a compositor that never answers holds nothing up for long */
+    g_atomic_int_set(&server.silent, TRUE);
+    char *reply = hypr_ipc_request("j/version", &ib.error);
+    if (reply || !g_error_matches(ib.error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT)) {
+        g_printerr("ipc: a request to a silent server did not time out\n");
+        ok = FALSE;
+    }
+    g_free(reply);
+    g_clear_error(&ib.error);
+
+    mock_server_stop(&server);
+    g_ptr_array_unref(ib.commands);
+    if (old_signature) g_setenv("HYPRLAND_INSTANCE_SIGNATURE", old_signature, TRUE);
+    else g_unsetenv("HYPRLAND_INSTANCE_SIGNATURE");
+    g_free(old_signature);
+    g_free(signature);
+    g_free(path);
+    return ok;
+}
+
+/* ------------------------- flush on quit ------------------------ */
+typedef struct {
+    KeybindsBench *kb;
+    guint round;
+    gboolean ok;
+} FlushBench;
+
+/* Inserts line at the top of section s of the file on disk */
+static void edit_on_disk(const char *path, int s, const char *line) {
+    gchar *contents = NULL;
+    GError *error = NULL;
+    check(g_file_get_contents(path, &contents, NULL, &error), error);
+    char *header = g_strdup_printf("## Section %d\n", s);
+    char *at = strstr(contents, header);
+    if (!at) exit(1);
+    at += strlen(header);
+    char *edited = g_strdup_printf("%.*s%s\n%s", (int)(at - contents), contents, line, at);
+    check(g_file_set_contents(path, edited, -1, &error), error);
+    g_free(edited);
+    g_free(header);
+    g_free(contents);
+}
+
+/* An edit waiting for the write-behind, and another program editing
+ * section s of the file meanwhile */
+static void edit_section_both_sides(FlushBench *fb, int s) {
+    free_keybinds();
+    write_keybinds(fb->kb->conf, CHURN_LINES);
+    bench_parse(fb->kb);
+    fb->round++;
+
+    char *text = g_strdup_printf("bind = SUPER ALT, Q, exec, flush-%u", fb->round);
+    model_replace_bind(0, 0, text);
+    keybinds_save_later();
+    g_free(text);
+
+    text = g_strdup_printf("bind = SUPER ALT, W, exec, external-%u", fb->round);
+    edit_on_disk(fb->kb->conf, s < 0 ? g_section_count - 1 : s, text);
+    g_free(text);
+}
+
+static void edit_both_sides(gpointer data) {
+    edit_section_both_sides(data, -1);
+}
+
+static void bench_flush(gpointer data) {
+    FlushBench *fb = data;
+    if (!keybinds_save_flush()) fb->ok = FALSE;
+}
+
+/* Which of this round's edits are on disk */
+static void edits_on_disk(FlushBench *fb, gboolean *ours, gboolean *theirs) {
+    gchar *contents = NULL;
+    *ours = *theirs = FALSE;
+    if (!g_file_get_contents(fb->kb->conf, &contents, NULL, NULL)) return;
+    char *our_line = g_strdup_printf("exec, flush-%u\n", fb->round);
+    char *their_line = g_strdup_printf("exec, external-%u\n", fb->round);
+    *ours = strstr(contents, our_line) != NULL;
+    *theirs = strstr(contents, their_line) != NULL;
+    g_free(their_line);
+    g_free(our_line);
+    g_free(contents);
+}
+
+static gboolean run_flush(GString *out, KeybindsBench *kb) {
+    if (opt_only && !strstr(opt_only, "flush")) return TRUE;
+
+    snprintf(g_filepath, sizeof(g_filepath), "%s", kb->conf);
+    FlushBench fb = { kb, 0, TRUE };
+    Bench flush = { "flush", "lines", CHURN_LINES, 0, edit_both_sides, bench_flush, &fb };
+    run_bench(out, &flush);
+    gboolean ours, theirs;
+    edits_on_disk(&fb, &ours, &theirs);
+    gboolean ok = fb.ok && ours && theirs;
+    if (!ok) g_printerr("flush: an edit made while the file changed on disk was not saved\n");
+
+    /* the same section on both sides cannot be merged: the external edit
+     * wins, and the flush has to say ours was lost */
+    edit_section_both_sides(&fb, 0);
+    gboolean saved = keybinds_save_flush();
+    edits_on_disk(&fb, &ours, &theirs);
+    if (saved || ours || !theirs) {
+        g_printerr("flush: an edit to a section also edited on disk was %s\n",
+                   saved ? "reported as saved" : "written over the external one");
+        ok = FALSE;
+    }
+
+    free_keybinds();
+    g_filepath[0] = '\0';
+    return ok;
+}
+
+/* ------------------------- waybar reload ------------------------ */
+#define DUMMY_BARS 2
+
+/* Stands in for Waybar: takes its name, then reports every SIGUSR2 on fd.
+ * Only async-signal-safe calls, since the parent has threads. */
+static void run_dummy_bar(const char *name, int fd) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR2);
+    sigprocmask(SIG_BLOCK, &set, NULL);
+    prctl(PR_SET_NAME, name, 0, 0, 0);
+    if (write(fd, "+", 1) != 1) _exit(1);  /* ready */
+
+    for (;;) {
+        int sig;
+        if (sigwait(&set, &sig) != 0 || write(fd, "r", 1) != 1) _exit(0);
+    }
+}
+
+typedef struct {
+    pid_t pids[DUMMY_BARS];
+    int fds[DUMMY_BARS];   /* read ends, one byte per handled signal */
+    gboolean done;
+    WaybarReloadResult result;
+    GError *error;
+} ReloadBench;
+
+static void on_bench_reloaded(GObject *source_object, GAsyncResult *result, gpointer user_data) {
+    ReloadBench *rb = user_data;
+    if (!waybar_reload_finish(result, &rb->result, &rb->error)) rb->result.processes = 0;
+    rb->done = TRUE;
+}
+
+/* From the request to every dummy having handled its signal */
+static void bench_reload(gpointer data) {
+    ReloadBench *rb = data;
+    rb->done = FALSE;
+    waybar_reload_async(on_bench_reloaded, rb);
+    while (!rb->done) g_main_context_iteration(NULL, TRUE);
+    check(rb->error == NULL && rb->result.method == WAYBAR_RELOAD_SIGNAL, rb->error);
+
+    char c;
+    for (guint i = 0; i < rb->result.processes && i < DUMMY_BARS; i++)
+        if (read(rb->fds[i], &c, 1) != 1) exit(1);
+}
+
+static gboolean run_reload(GString *out) {
+    if (opt_only && !strstr(opt_only, "reload")) return TRUE;
+
+    /* a name no real process has; the second dummy is its wrapped form,
+     * which still fits in a 15 character comm */
+    char name[16], wrapped[16];
+    snprintf(name, sizeof(name), "kb%04d", (int)(getpid() % 10000));
+    snprintf(wrapped, sizeof(wrapped), ".%s-wrapped", name);
+
+    ReloadBench rb = { { 0 } };
+    for (int i = 0; i < DUMMY_BARS; i++) {
+        int fds[2];
+        if (pipe(fds) != 0) exit(1);
+        rb.pids[i] = fork();
+        if (rb.pids[i] == 0) {
+            close(fds[0]);
+            run_dummy_bar(i == 0 ? name : wrapped, fds[1]);
+        }
+        close(fds[1]);
+        rb.fds[i] = fds[0];
+        char c;
+        if (rb.pids[i] < 0 || read(rb.fds[i], &c, 1) != 1) exit(1);
+    }
+
+    waybar_reload_set_process_name(name);
+    waybar_reload_set_script("");
+    Bench reload = { "reload", "processes", DUMMY_BARS, 0, NULL, bench_reload, &rb };
+    run_bench(out, &reload);
+    gboolean ok = rb.result.processes == DUMMY_BARS;
+    if (!ok) g_printerr("reload: signalled %u of %d dummy bars\n", rb.result.processes, DUMMY_BARS);
+
+    for (int i = 0; i < DUMMY_BARS; i++) {
+        kill(rb.pids[i], SIGTERM);
+        waitpid(rb.pids[i], NULL, 0);
+        close(rb.fds[i]);
+    }
+    waybar_reload_set_process_name(NULL);
+    waybar_reload_set_script(NULL);
+    return ok;
+}
+
+/* ------------------------- main ------------------------ */
+static const GOptionEntry option_entries[] = {
+    { "sizes", 0, 0, G_OPTION_ARG_STRING, &opt_sizes,
+      "keybinds.conf sizes to parse and rewrite, in lines (default " DEFAULT_SIZES ")", "N,N,..." },
+    { "files", 0, 0, G_OPTION_ARG_INT, &opt_files, "Files in the generated preset tree", "N" },
+    { "min-time", 0, 0, G_OPTION_ARG_DOUBLE, &opt_min_time, "Seconds to run each benchmark for", "SEC" },
+    { "iterations", 0, 0, G_OPTION_ARG_INT, &opt_iterations, "Fixed iteration count instead", "N" },
+    { "only", 0, 0, G_OPTION_ARG_STRING, &opt_only, "Comma separated benchmarks to run", "NAMES" },
+    { "durable", 0, 0, G_OPTION_ARG_NONE, &opt_durable, "fsync in rewrite, like the app's default", NULL },
+    { "churn", 0, 0, G_OPTION_ARG_INT, &opt_churn,
+      "Edit/search cycles in the churn check (default 100000, 0 to skip)", "N" },
+    G_OPTION_ENTRY_NULL
+};
+
+int main(int argc, char *argv[]) {
+    GError *error = NULL;
+    GOptionContext *context = g_option_context_new("- benchmark settings-core");
+    g_option_context_add_main_entries(context, option_entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        return 2;
+    }
+    g_option_context_free(context);
+
+    /* keep an explicit fsync out of the numbers unless asked for */
+    g_write_durability = opt_durable ? WRITE_DURABLE : WRITE_CONSISTENT;
+
+    char *tmp = g_dir_make_tmp("settings-bench-XXXXXX", &error);
+    check(tmp != NULL, error);
+    /* indexes, caches and the mock Hyprland socket go into the scratch
+     * directory, not the user's */
+    char *cache = g_build_filename(tmp, "cache", NULL);
+    g_setenv("XDG_CACHE_HOME", cache, TRUE);
+    g_free(cache);
+    char *runtime = g_build_filename(tmp, "run", NULL);
+    g_mkdir_with_parents(runtime, 0700);
+    g_setenv("XDG_RUNTIME_DIR", runtime, TRUE);
+    g_free(runtime);
+
+    GString *out = g_string_new("{\n  \"benchmark\": \"settings-core\",\n");
+    g_string_append_printf(out, "  \"timestamp\": %" G_GINT64_FORMAT ",\n", g_get_real_time() / G_USEC_PER_SEC);
+    g_string_append(out, "  \"results\": [");
+
+    KeybindsBench kb = { g_build_filename(tmp, "keybinds.conf", NULL),
+                         g_build_filename(tmp, "keybinds.out.conf", NULL) };
+    char **sizes = g_strsplit(opt_sizes ? opt_sizes : DEFAULT_SIZES, ",", -1);
+    for (char **s = sizes; *s; s++) {
+        gint64 lines = g_ascii_strtoll(*s, NULL, 10);
+        if (lines <= 0) continue;
+        gint64 bytes = write_keybinds(kb.conf, lines);
+
+        Bench parse = { "parse", "lines", lines, bytes, NULL, bench_parse, &kb };
+        run_bench(out, &parse);
+        if (!g_sections) bench_parse(&kb);
+        Bench rewrite = { "rewrite", "lines", lines, bytes, NULL, bench_rewrite, &kb };
+        run_bench(out, &rewrite);
+
+        /* the launch after this one: the config did not change */
+        if (!opt_only || strstr(opt_only, "cache")) keybinds_cache_save(kb.conf, g_sections, g_section_count);
+        Bench cache = { "cache", "lines", lines, bytes, NULL, bench_cache, &kb };
+        run_bench(out, &cache);
+        free_keybinds();
+    }
+    g_strfreev(sizes);
+    gboolean flat = run_churn(out, &kb, tmp);
+    gboolean live = run_live(out, &kb);
+    gboolean ipc = run_ipc(out);
+    gboolean flushed = run_flush(out, &kb);
+    gboolean reloaded = run_reload(out);
+
+    PresetBench pb = { g_build_filename(tmp, "waybar", NULL), g_build_filename(tmp, "store", NULL),
+                       g_build_filename(tmp, "applied", NULL), MAX(opt_files, 1) };
+    pb.edits = MAX(pb.files / 100, 1);
+    gint64 tree_bytes = write_tree(pb.src, pb.files);
+
+    Bench save = { "save", "files", pb.files, tree_bytes, reset_store, bench_save, &pb };
+    run_bench(out, &save);
+    if (!preset_store_has_snapshot(pb.root, "bench")) bench_save(&pb);
+
+    Bench copy = { "copy", "files", pb.files, tree_bytes, reset_dest, bench_apply, &pb };
+    run_bench(out, &copy);
+    if (!g_file_test(pb.dest, G_FILE_TEST_IS_DIR)) bench_apply(&pb);
+
+    /* same tree as copy, but only the edited files need writing */
+    Bench apply = { "apply", "files", pb.files, tree_bytes, edit_dest, bench_apply, &pb };
+    run_bench(out, &apply);
+
+    g_string_append(out, "\n  ]\n}\n");
+    fputs(out->str, stdout);
+    g_string_free(out, TRUE);
+
+    file_tree_remove(tmp, NULL, NULL);
+    g_free(pb.src);
+    g_free(pb.root);
+    g_free(pb.dest);
+    g_free(kb.conf);
+    g_free(kb.out);
+    g_free(tmp);
+    return flat && live && ipc && flushed && reloaded ? 0 : 1;
+}
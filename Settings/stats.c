@@ -0,0 +1,116 @@
+#include "stats.h"
+#include <string.h>
+#ifdef HAVE_SYSPROF
+#include <sysprof-capture.h>
+#endif
+
+/* Log-linear buckets: exact below SUB_BUCKETS usec, then SUB_BUCKETS
+ * buckets per power of two, so any value is within 12.5% of its bucket */
+#define SUB_BITS 3
+#define SUB_BUCKETS (1 << SUB_BITS)
+#define N_BUCKETS (64 * SUB_BUCKETS)
+
+typedef struct {
+    guint64 count;
+    guint64 sum;
+    guint64 max;
+    guint32 buckets[N_BUCKETS];
+} Histogram;
+
+static const char *const metric_names[STATS_N_METRICS] = {
+    [STATS_PARSE] = "parse_keybinds",
+    [STATS_CACHE_LOAD] = "cache_load",
+    [STATS_REWRITE] = "rewrite_config",
+    [STATS_REBUILD_UI] = "rebuild_ui",
+    [STATS_PRESET_SAVE] = "preset_save",
+    [STATS_PRESET_APPLY] = "preset_apply",
+    [STATS_TREE_REMOVE] = "tree_remove",
+    [STATS_WAYBAR_RELOAD] = "waybar_reload",
+    [STATS_FRAME] = "frame",
+    [STATS_FIRST_FRAME] = "first_frame",
+};
+
+gboolean stats_enabled = FALSE;
+
+static GMutex g_lock;
+static Histogram *g_histograms = NULL; /* STATS_N_METRICS of them */
+
+void stats_enable(void) {
+    if (stats_enabled) return;
+    g_histograms = g_new0(Histogram, STATS_N_METRICS);
+    stats_enabled = TRUE;
+}
+
+/* ------------------------- histograms ------------------------ */
+static guint bucket_for(guint64 v) {
+    if (v < SUB_BUCKETS) return v;
+    guint shift = g_bit_nth_msf(v, -1) - SUB_BITS;
+    return (shift + 1) * SUB_BUCKETS + ((v >> shift) & (SUB_BUCKETS - 1));
+}
+
+static guint64 bucket_low(guint i) {
+    if (i < SUB_BUCKETS) return i;
+    guint shift = i / SUB_BUCKETS - 1;
+    return (guint64)(SUB_BUCKETS + i % SUB_BUCKETS) << shift;
+}
+
+static guint64 bucket_mid(guint i) {
+    if (i < SUB_BUCKETS) return i;
+    guint shift = i / SUB_BUCKETS - 1;
+    return bucket_low(i) + (((guint64)1 << shift) >> 1);
+}
+
+static guint64 histogram_percentile(const Histogram *h, double q) {
+    guint64 rank = (guint64)(q * h->count + 0.999999), seen = 0;
+    for (guint i = 0; i < N_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= MAX(rank, 1)) return MIN(bucket_mid(i), h->max);
+    }
+    return h->max;
+}
+
+void stats_record(StatsMetric metric, gint64 start, gint64 usec) {
+    if (!stats_enabled || usec < 0) return;
+
+    g_mutex_lock(&g_lock);
+    Histogram *h = &g_histograms[metric];
+    h->count++;
+    h->sum += usec;
+    h->max = MAX(h->max, (guint64)usec);
+    h->buckets[bucket_for(usec)]++;
+    g_mutex_unlock(&g_lock);
+
+#ifdef HAVE_SYSPROF
+    /* both CLOCK_MONOTONIC; a no-op unless sysprof is recording */
+    sysprof_collector_mark(start * 1000, usec * 1000, "settings", metric_names[metric], NULL);
+#endif
+}
+
+void stats_end_span(StatsMetric metric, gint64 start) {
+    stats_record(metric, start, g_get_monotonic_time() - start);
+}
+
+/* ------------------------- report ------------------------ */
+void stats_print_summary(void) {
+    if (!stats_enabled) {
+        g_print("Statistics are off; start with --stats to collect them\n");
+        return;
+    }
+
+    Histogram *copy = g_new(Histogram, STATS_N_METRICS);
+    g_mutex_lock(&g_lock);
+    memcpy(copy, g_histograms, sizeof(Histogram) * STATS_N_METRICS);
+    g_mutex_unlock(&g_lock);
+
+    g_print("%-16s %8s %10s %10s %10s %10s %10s  (ms)\n", "metric", "count", "mean", "p50", "p90",
+            "p99", "max");
+    for (int i = 0; i < STATS_N_METRICS; i++) {
+        const Histogram *h = &copy[i];
+        if (h->count == 0) continue;
+        g_print("%-16s %8" G_GUINT64_FORMAT " %10.3f %10.3f %10.3f %10.3f %10.3f\n", metric_names[i],
+                h->count, (double)h->sum / h->count / 1000.0,
+                histogram_percentile(h, 0.50) / 1000.0, histogram_percentile(h, 0.90) / 1000.0,
+                histogram_percentile(h, 0.99) / 1000.0, h->max / 1000.0);
+    }
+    g_free(copy);
+}
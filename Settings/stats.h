@@ -0,0 +1,50 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <glib.h>
+
+/* Timing spans and frame times, collected into per-metric histograms.
+ * Off unless stats_enable() is called (--stats, or when running under
+ * sysprof): a disabled span is one branch on stats_enabled.
+ *
+ *   gint64 span = stats_begin();
+ *   ...
+ *   stats_end(STATS_PARSE, span);
+ *
+ * Thread-safe; preset jobs record from their worker threads. */
+typedef enum {
+    STATS_PARSE,        /* parse_keybinds() */
+    STATS_CACHE_LOAD,   /* keybinds_cache_load() that hit */
+    STATS_REWRITE,      /* rewrite_config() */
+    STATS_REBUILD_UI,   /* rebuild_ui() */
+    STATS_PRESET_SAVE,  /* preset_store_save() */
+    STATS_PRESET_APPLY, /* preset_store_apply() */
+    STATS_TREE_REMOVE,  /* file_tree_remove() */
+    STATS_WAYBAR_RELOAD, /* waybar_reload_async(): signals delivered, or the script done */
+    STATS_FRAME,        /* interval between painted frames of the main window */
+    STATS_FIRST_FRAME,  /* main(), or a later activation, to the next painted frame of the main window */
+    STATS_N_METRICS
+} StatsMetric;
+
+extern gboolean stats_enabled;
+
+void stats_enable(void);
+
+static inline gint64 stats_begin(void) {
+    return G_UNLIKELY(stats_enabled) ? g_get_monotonic_time() : 0;
+}
+
+/* Records now - start (monotonic usec) */
+void stats_end_span(StatsMetric metric, gint64 start);
+
+static inline void stats_end(StatsMetric metric, gint64 start) {
+    if (G_UNLIKELY(start)) stats_end_span(metric, start);
+}
+
+/* Records a duration measured elsewhere */
+void stats_record(StatsMetric metric, gint64 start, gint64 usec);
+
+/* Count, mean, p50/p90/p99 and max of every metric seen so far */
+void stats_print_summary(void);
+
+#endif // STATS_H
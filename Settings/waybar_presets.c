@@ -1,7 +1,13 @@
 #include "waybar_presets.h"
+#include "preset_store.h"
+#include "preset_index.h"
+#include "file_tree.h"
+#include "waybar_reload.h"
+#include "stats.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <gio/gio.h>
@@ -12,142 +18,384 @@ typedef struct {
     GtkWidget *entry;
 } SaveWidgets;
 
+/* One apply/save/delete running on a worker thread. total and done are
+ * file counts written by the worker and polled by the UI. */
+typedef enum {
+    JOB_APPLY,
+    JOB_SAVE,
+    JOB_DELETE,
+    JOB_RESTORE,
+} PresetJobKind;
+
+typedef struct {
+    PresetJobKind kind;
+    char *root; /* the preset store */
+    char *name;
+    char *path; /* Waybar config dir applied to or saved from */
+    gint total;
+    gint done;
+    PresetChanges changes; /* apply and restore */
+} PresetJob;
+
+#define PROGRESS_INTERVAL_MS 100
+
 static GtkWidget *presets_box = NULL;
+static GtkWidget *save_button = NULL;
+static GtkWidget *restore_button = NULL;
+static GtkWidget *progress_row = NULL;
+static GtkWidget *progress_bar = NULL;
+
+static PresetJob *current_job = NULL; /* owned by its GTask */
+static GCancellable *current_cancellable = NULL;
+static guint progress_source = 0;
+static guint list_generation = 0; /* drops stale refresh results */
 
 /* Forward declarations */
 static void refresh_presets_list(void);
 
-/* Copy directory recursively using GFile (GTK4-safe) */
-static gboolean copy_directory(const char *src, const char *dest) {
-    if (!g_file_test(src, G_FILE_TEST_EXISTS)) return FALSE;
-    g_mkdir_with_parents(dest, 0755);
-
-    GDir *dir = g_dir_open(src, 0, NULL);
-    if (!dir) return FALSE;
-
-    const char *filename;
-    while ((filename = g_dir_read_name(dir))) {
-        char src_path[1024], dest_path[1024];
-        snprintf(src_path, sizeof(src_path), "%s/%s", src, filename);
-        snprintf(dest_path, sizeof(dest_path), "%s/%s", dest, filename);
-
-        if (g_file_test(src_path, G_FILE_TEST_IS_DIR)) {
-            copy_directory(src_path, dest_path);
-        } else {
-            GFile *src_file = g_file_new_for_path(src_path);
-            GFile *dest_file = g_file_new_for_path(dest_path);
-            GError *error = NULL;
-
-            g_file_copy(src_file, dest_file, G_FILE_COPY_OVERWRITE, NULL, NULL, NULL, &error);
-            if (error) {
-                g_printerr("Failed to copy %s: %s\n", src_path, error->message);
-                g_clear_error(&error);
-            }
+static const char *home_dir(void) {
+    const char *home = getenv("HOME");
+    return home ? home : "/root";
+}
 
-            g_object_unref(src_file);
-            g_object_unref(dest_file);
-        }
+static char *presets_root(void) {
+    return g_strdup_printf("%s/.config/settings-app/waybar-presets", home_dir());
+}
+
+/* A directory and not a symlink to one: never recurse through links */
+static gboolean is_real_dir(const char *path) {
+    GStatBuf st;
+    return g_lstat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+/* ------------------------- worker ------------------------ */
+static void preset_job_free(gpointer data) {
+    PresetJob *job = data;
+    g_free(job->root);
+    g_free(job->name);
+    g_free(job->path);
+    preset_changes_clear(&job->changes);
+    g_free(job);
+}
+
+/* Presets saved before the store existed are plain copies of the config;
+ * move one aside, snapshot it into the store and drop the copy */
+static gboolean import_legacy_preset(PresetJob *job, GCancellable *cancellable, GError **error) {
+    char *preset_dir = g_build_filename(job->root, job->name, NULL);
+    char *import_dir = g_strdup_printf("%s/.import-%s", job->root, job->name);
+    gboolean ok = FALSE;
+
+    if (!is_real_dir(preset_dir)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "%s does not exist", preset_dir);
+    } else if (g_rename(preset_dir, import_dir) != 0) {
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errno), "Failed to import %s: %s",
+                    preset_dir, g_strerror(errno));
+    } else if (!preset_store_save(job->root, job->name, import_dir, NULL, cancellable, error)) {
+        g_rename(import_dir, preset_dir);
+    } else {
+        file_tree_remove(import_dir, NULL, NULL);
+        g_print("Imported Waybar preset %s into the preset store\n", job->name);
+        ok = TRUE;
     }
-    g_dir_close(dir);
-    return TRUE;
+
+    g_free(import_dir);
+    g_free(preset_dir);
+    return ok;
+}
+
+/* Swap in a preset as ~/.config/waybar, writing only what differs */
+static gboolean apply_preset(PresetJob *job, const char *name, GCancellable *cancellable,
+                             GError **error) {
+    g_atomic_int_set(&job->total, preset_store_count_files(job->root, name));
+    return preset_store_apply(job->root, name, job->path, &job->changes, &job->done,
+                              cancellable, error);
 }
 
-/* Recursively delete a directory */
-static gboolean delete_directory(const char *path) {
-    if (!g_file_test(path, G_FILE_TEST_EXISTS)) return TRUE;
-
-    GDir *dir = g_dir_open(path, 0, NULL);
-    if (!dir) return g_remove(path) == 0;
-
-    const char *filename;
-    while ((filename = g_dir_read_name(dir))) {
-        char child_path[1024];
-        snprintf(child_path, sizeof(child_path), "%s/%s", path, filename);
-        if (g_file_test(child_path, G_FILE_TEST_IS_DIR)) {
-            delete_directory(child_path);
-        } else {
-            g_remove(child_path);
+static void preset_job_thread(GTask *task, gpointer source_object, gpointer task_data,
+                              GCancellable *cancellable) {
+    PresetJob *job = task_data;
+    GError *error = NULL;
+    gboolean ok = TRUE;
+
+    switch (job->kind) {
+    case JOB_APPLY:
+        if (!preset_store_has_snapshot(job->root, job->name)
+            && !import_legacy_preset(job, cancellable, &error)) {
+            ok = FALSE;
+            break;
+        }
+        ok = apply_preset(job, job->name, cancellable, &error);
+        if (ok) preset_index_mark_applied(job->root, job->name);
+        break;
+
+    case JOB_SAVE:
+        g_atomic_int_set(&job->total, file_tree_count(job->path, cancellable));
+        ok = preset_store_save(job->root, job->name, job->path, &job->done, cancellable, &error);
+        /* blobs written before a failure belong to no snapshot */
+        if (ok) preset_index_update(job->root, job->name);
+        else preset_store_gc(job->root);
+        break;
+
+    case JOB_DELETE: {
+        char *preset_dir = g_build_filename(job->root, job->name, NULL);
+        g_atomic_int_set(&job->total, file_tree_count(preset_dir, cancellable));
+        if (!file_tree_remove(preset_dir, &job->done, cancellable)
+            && !g_cancellable_set_error_if_cancelled(cancellable, &error)) {
+            g_set_error(&error, G_IO_ERROR, G_IO_ERROR_FAILED, "could not remove %s", preset_dir);
         }
+        g_free(preset_dir);
+        ok = error == NULL;
+        if (ok) {
+            preset_index_remove(job->root, job->name);
+            preset_store_gc(job->root);
+        }
+        break;
     }
-    g_dir_close(dir);
 
-    return g_rmdir(path) == 0;
+    case JOB_RESTORE:
+        if (!preset_store_has_snapshot(job->root, PRESET_STORE_PREVIOUS)) {
+            g_set_error(&error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "No previous Waybar config to restore");
+            ok = FALSE;
+            break;
+        }
+        ok = apply_preset(job, PRESET_STORE_PREVIOUS, cancellable, &error);
+        break;
+    }
+
+    if (ok) g_task_return_boolean(task, TRUE);
+    else g_task_return_error(task, error);
 }
 
-/* Empty a directory but keep the folder itself */
-static void empty_directory(const char *dir_path) {
-    GDir *dir = g_dir_open(dir_path, 0, NULL);
-    if (!dir) return;
-
-    const char *filename;
-    while ((filename = g_dir_read_name(dir))) {
-        char child_path[1024];
-        snprintf(child_path, sizeof(child_path), "%s/%s", dir_path, filename);
-        if (g_file_test(child_path, G_FILE_TEST_IS_DIR)) {
-            delete_directory(child_path);
-        } else {
-            g_remove(child_path);
-        }
+/* ------------------------- progress UI ------------------------ */
+static const char *job_verb(const PresetJob *job) {
+    switch (job->kind) {
+    case JOB_APPLY: return "Applying";
+    case JOB_SAVE: return "Saving";
+    case JOB_DELETE: return "Deleting";
+    case JOB_RESTORE: return "Restoring";
     }
-    g_dir_close(dir);
+    return "";
 }
 
-/* Callback when a preset button is clicked */
-static void on_preset_clicked(GtkButton *button, gpointer user_data) {
-    char *preset_name = (char *)user_data;
+static gboolean on_progress_tick(gpointer user_data) {
+    if (!current_job || !progress_bar) {
+        progress_source = 0;
+        return G_SOURCE_REMOVE;
+    }
 
-    const char *home = getenv("HOME");
-    if (!home) home = "/root";
+    gint total = g_atomic_int_get(&current_job->total);
+    gint done = g_atomic_int_get(&current_job->done);
+    char text[256];
+    if (total > 0) {
+        gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(progress_bar),
+                                      MIN((double)done / total, 1.0));
+        snprintf(text, sizeof(text), "%s %s: %d/%d files", job_verb(current_job),
+                 current_job->name, MIN(done, total), total);
+    } else {
+        gtk_progress_bar_pulse(GTK_PROGRESS_BAR(progress_bar));
+        snprintf(text, sizeof(text), "%s %s...", job_verb(current_job), current_job->name);
+    }
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(progress_bar), text);
+    return G_SOURCE_CONTINUE;
+}
 
-    char preset_dir[1024], dest_dir[1024];
-    snprintf(preset_dir, sizeof(preset_dir),
-             "%s/.config/settings-app/waybar-presets/%s", home, preset_name);
-    snprintf(dest_dir, sizeof(dest_dir),
-             "%s/.config/waybar", home);
+static void set_busy(gboolean busy) {
+    if (presets_box) gtk_widget_set_sensitive(presets_box, !busy);
+    if (save_button) gtk_widget_set_sensitive(save_button, !busy);
+    if (restore_button) gtk_widget_set_sensitive(restore_button, !busy);
+    if (progress_row) gtk_widget_set_visible(progress_row, busy);
+    if (busy && progress_bar) gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(progress_bar), 0.0);
+
+    if (busy && !progress_source)
+        progress_source = g_timeout_add(PROGRESS_INTERVAL_MS, on_progress_tick, NULL);
+    else if (!busy && progress_source)
+        g_clear_handle_id(&progress_source, g_source_remove);
+}
 
-    /* Clear existing Waybar config */
-    empty_directory(dest_dir);
+static void on_cancel_job_clicked(GtkButton *button, gpointer user_data) {
+    if (current_cancellable) g_cancellable_cancel(current_cancellable);
+}
 
-    /* Copy preset into now-empty config folder */
-    copy_directory(preset_dir, dest_dir);
+static void on_waybar_reloaded(GObject *source_object, GAsyncResult *result, gpointer user_data) {
+    WaybarReloadResult reload;
+    GError *error = NULL;
+    if (!waybar_reload_finish(result, &reload, &error)) {
+        g_printerr("Failed to reload Waybar: %s\n", error->message);
+        g_clear_error(&error);
+    } else if (reload.method == WAYBAR_RELOAD_SIGNAL) {
+        g_print("Reloaded Waybar in place (%u process%s) in %.1f ms\n", reload.processes,
+                reload.processes == 1 ? "" : "es", reload.usec / 1000.0);
+    } else {
+        g_print("Started Waybar with the reload script in %.1f ms\n", reload.usec / 1000.0);
+    }
+    g_application_release(g_application_get_default());
+}
 
-    g_print("Applied Waybar preset: %s\n", preset_name);
+/* In place when Waybar is running, else through the reload script */
+static void reload_waybar(void) {
+    g_application_hold(g_application_get_default());
+    waybar_reload_async(on_waybar_reloaded, NULL);
+}
 
-    /* Run Waybar reload script */
-    char script_path[1024];
-    snprintf(script_path, sizeof(script_path),
-             "%s/Dots/Scripts/Waybar/waybar.sh", home);
+static void print_changes(const PresetChanges *changes) {
+    static const char marks[] = { '+', '~', '-', '>' };
+    GPtrArray *lists[] = { changes->added, changes->modified, changes->removed, changes->renamed };
+    for (gsize i = 0; i < G_N_ELEMENTS(lists); i++) {
+        for (guint j = 0; j < lists[i]->len; j++)
+            g_print("  %c %s\n", marks[i], (const char *)g_ptr_array_index(lists[i], j));
+    }
+}
 
+static void on_preset_job_done(GObject *source_object, GAsyncResult *result, gpointer user_data) {
+    PresetJob *job = g_task_get_task_data(G_TASK(result));
     GError *error = NULL;
-    if (!g_spawn_command_line_async(script_path, &error)) {
-        g_printerr("Failed to run script: %s\n", error->message);
-        g_clear_error(&error);
+    gboolean ok = g_task_propagate_boolean(G_TASK(result), &error);
+
+    current_job = NULL;
+    g_clear_object(&current_cancellable);
+    set_busy(FALSE);
+
+    if (ok) {
+        switch (job->kind) {
+        case JOB_APPLY:
+            if (preset_changes_count(&job->changes) == 0) {
+                g_print("Waybar preset %s is already applied\n", job->name);
+                break;
+            }
+            g_print("Applied Waybar preset: %s\n", job->name);
+            print_changes(&job->changes);
+            reload_waybar();
+            break;
+        case JOB_SAVE:
+            g_print("Saved Waybar preset: %s\n", job->name);
+            break;
+        case JOB_DELETE:
+            g_print("Deleted Waybar preset: %s\n", job->name);
+            break;
+        case JOB_RESTORE:
+            g_print("Restored the previous Waybar config\n");
+            print_changes(&job->changes);
+            if (preset_changes_count(&job->changes) > 0) reload_waybar();
+            break;
+        }
+    } else if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_printerr("%s %s cancelled\n", job_verb(job), job->name);
+    } else {
+        g_printerr("%s %s failed: %s\n", job_verb(job), job->name, error->message);
+    }
+    g_clear_error(&error);
+
+    /* apply updates the row's last-applied time, and may have imported it */
+    refresh_presets_list();
+    g_application_release(g_application_get_default());
+}
+
+/* Start a job on preset name unless one is already running */
+static void start_preset_job(PresetJobKind kind, const char *name) {
+    if (current_job) {
+        g_printerr("%s %s is still running\n", job_verb(current_job), current_job->name);
+        return;
     }
+
+    PresetJob *job = g_new0(PresetJob, 1);
+    job->kind = kind;
+    job->root = presets_root();
+    job->name = g_strdup(name);
+    job->path = g_strdup_printf("%s/.config/waybar", home_dir());
+    preset_changes_init(&job->changes);
+
+    current_job = job;
+    current_cancellable = g_cancellable_new();
+    set_busy(TRUE);
+    on_progress_tick(NULL);
+
+    /* Keep the process alive until the worker is done, even if the window closes */
+    g_application_hold(g_application_get_default());
+
+    GTask *task = g_task_new(NULL, current_cancellable, on_preset_job_done, NULL);
+    g_task_set_task_data(task, job, preset_job_free);
+    g_task_run_in_thread(task, preset_job_thread);
+    g_object_unref(task);
+}
+
+/* ------------------------- presets tab ------------------------ */
+/* Callback when a preset button is clicked */
+static void on_preset_clicked(GtkButton *button, gpointer user_data) {
+    char *preset_name = (char *)user_data;
+
+    start_preset_job(JOB_APPLY, preset_name);
+}
+
+/* Swap back the config the last apply replaced */
+static void on_restore_clicked(GtkButton *button, gpointer user_data) {
+    start_preset_job(JOB_RESTORE, "previous config");
 }
 
 /* Callback when delete button is clicked */
 static void on_delete_preset(GtkButton *button, gpointer user_data) {
     char *preset_name = (char *)user_data;
 
-    const char *home = getenv("HOME");
-    if (!home) home = "/root";
+    start_preset_job(JOB_DELETE, preset_name);
+}
 
-    char preset_dir[1024];
-    snprintf(preset_dir, sizeof(preset_dir),
-             "%s/.config/settings-app/waybar-presets/%s", home, preset_name);
+/* Runs on a worker: mtime checks against the cached index, describing only
+ * presets that changed since it was written */
+static void list_presets_thread(GTask *task, gpointer source_object, gpointer task_data,
+                                GCancellable *cancellable) {
+    const char *root = task_data;
+    g_mkdir_with_parents(root, 0755);
+    g_task_return_pointer(task, preset_index_list(root), (GDestroyNotify)g_ptr_array_unref);
+}
 
-    if (delete_directory(preset_dir)) {
-        g_print("Deleted Waybar preset: %s\n", preset_name);
-    } else {
-        g_printerr("Failed to delete preset: %s\n", preset_name);
+static char *describe_preset(const PresetInfo *info) {
+    GString *text = g_string_new(NULL);
+    g_string_append_printf(text, "%d files", info->files);
+    if (info->size > 0) {
+        char *size = g_format_size(info->size);
+        g_string_append_printf(text, " \u00b7 %s", size);
+        g_free(size);
+    }
+    if (!info->hash) g_string_append(text, " \u00b7 not imported yet");
+    if (info->applied > 0) {
+        GDateTime *when = g_date_time_new_from_unix_local(info->applied);
+        char *stamp = g_date_time_format(when, "%Y-%m-%d %H:%M");
+        g_string_append_printf(text, " \u00b7 applied %s", stamp);
+        g_free(stamp);
+        g_date_time_unref(when);
     }
+    return g_string_free(text, FALSE);
+}
 
-    refresh_presets_list();
+static GtkWidget *create_preset_row(const PresetInfo *info) {
+    GtkWidget *hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+
+    GtkWidget *btn = gtk_button_new_with_label(info->name);
+    gtk_widget_set_halign(btn, GTK_ALIGN_START);
+    g_signal_connect_data(btn, "clicked", G_CALLBACK(on_preset_clicked),
+                          g_strdup(info->name), (GClosureNotify)g_free, 0);
+
+    GtkWidget *del_btn = gtk_button_new_with_label("Delete");
+    g_signal_connect_data(del_btn, "clicked", G_CALLBACK(on_delete_preset),
+                          g_strdup(info->name), (GClosureNotify)g_free, 0);
+
+    char *details = describe_preset(info);
+    GtkWidget *label = gtk_label_new(details);
+    gtk_widget_add_css_class(label, "dim-label");
+    g_free(details);
+
+    gtk_box_append(GTK_BOX(hbox), btn);
+    gtk_box_append(GTK_BOX(hbox), del_btn);
+    gtk_box_append(GTK_BOX(hbox), label);
+    return hbox;
 }
 
-/* Refresh the list of existing presets */
-static void refresh_presets_list(void) {
-    if (!presets_box) return;
+static void on_presets_listed(GObject *source_object, GAsyncResult *result, gpointer user_data) {
+    GPtrArray *presets = g_task_propagate_pointer(G_TASK(result), NULL);
+    if (!presets) return;
+    if (!presets_box || GPOINTER_TO_UINT(user_data) != list_generation) {
+        g_ptr_array_unref(presets);
+        return;
+    }
 
     /* Clear old children safely in GTK4 */
     GtkWidget *child;
@@ -155,34 +403,24 @@ static void refresh_presets_list(void) {
         gtk_box_remove(GTK_BOX(presets_box), child);
     }
 
-    const char *home = getenv("HOME");
-    if (!home) home = "/root";
-    char presets_dir[1024];
-    snprintf(presets_dir, sizeof(presets_dir),
-             "%s/.config/settings-app/waybar-presets", home);
-    g_mkdir_with_parents(presets_dir, 0755);
-
-    GDir *dir = g_dir_open(presets_dir, 0, NULL);
-    if (!dir) return;
-
-    const char *name;
-    while ((name = g_dir_read_name(dir))) {
-        GtkWidget *hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
-
-        GtkWidget *btn = gtk_button_new_with_label(name);
-        gtk_widget_set_halign(btn, GTK_ALIGN_START);
-        g_signal_connect(btn, "clicked", G_CALLBACK(on_preset_clicked),
-                         g_strdup(name));
-
-        GtkWidget *del_btn = gtk_button_new_with_label("Delete");
-        g_signal_connect(del_btn, "clicked", G_CALLBACK(on_delete_preset),
-                         g_strdup(name));
-
-        gtk_box_append(GTK_BOX(hbox), btn);
-        gtk_box_append(GTK_BOX(hbox), del_btn);
-        gtk_box_append(GTK_BOX(presets_box), hbox);
-    }
-    g_dir_close(dir);
+    for (guint i = 0; i < presets->len; i++)
+        gtk_box_append(GTK_BOX(presets_box), create_preset_row(g_ptr_array_index(presets, i)));
+    g_ptr_array_unref(presets);
+}
+
+/* Refresh the list of existing presets; the old rows stay until the new
+ * list is ready */
+static void refresh_presets_list(void) {
+    if (!presets_box) return;
+
+    GTask *task = g_task_new(NULL, NULL, on_presets_listed, GUINT_TO_POINTER(++list_generation));
+    g_task_set_task_data(task, presets_root(), g_free);
+    g_task_run_in_thread(task, list_presets_thread);
+    g_object_unref(task);
+}
+
+void waybar_presets_refresh(void) {
+    refresh_presets_list();
 }
 
 /* Callback to destroy the dialog */
@@ -191,29 +429,19 @@ static void on_dialog_cancel(GtkButton *button, gpointer user_data) {
     gtk_window_destroy(GTK_WINDOW(dialog));
 }
 
-/* Callback for saving preset */
+/* Callback for saving preset; data is freed with the button */
 static void on_save_ok(GtkButton *button, gpointer user_data) {
     SaveWidgets *data = (SaveWidgets *)user_data;
     GtkWidget *dialog = data->dialog;
     GtkWidget *entry  = data->entry;
 
     const char *name = gtk_editable_get_text(GTK_EDITABLE(entry));
-    if (strlen(name) == 0) {
-        g_free(data);
+    /* '.' names are the store's own; tabs and newlines would break the index */
+    if (strlen(name) == 0 || strpbrk(name, "/\t\n") || name[0] == '.')
         return;
-    }
 
-    const char *home = getenv("HOME");
-    if (!home) home = "/root";
-    char src_dir[1024], dest_dir[1024];
-    snprintf(src_dir, sizeof(src_dir), "%s/.config/waybar", home);
-    snprintf(dest_dir, sizeof(dest_dir), "%s/.config/settings-app/waybar-presets/%s", home, name);
-
-    copy_directory(src_dir, dest_dir);
-    refresh_presets_list();
+    start_preset_job(JOB_SAVE, name);
     gtk_window_destroy(GTK_WINDOW(dialog));
-
-    g_free(data);
 }
 
 /* Callback when save button is clicked */
@@ -245,7 +473,8 @@ static void on_save_clicked(GtkButton *button, gpointer user_data) {
     data->dialog = dialog;
     data->entry  = entry;
 
-    g_signal_connect(btn_ok, "clicked", G_CALLBACK(on_save_ok), data);
+    g_signal_connect_data(btn_ok, "clicked", G_CALLBACK(on_save_ok), data,
+                          (GClosureNotify)g_free, 0);
     g_signal_connect(btn_cancel, "clicked", G_CALLBACK(on_dialog_cancel), dialog);
 
     gtk_window_present(GTK_WINDOW(dialog));
@@ -264,13 +493,37 @@ GtkWidget *create_waybar_presets_tab(GtkWindow *main_window) {
     gtk_widget_set_margin_bottom(vbox, 20);
     gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scroll), vbox);
 
-    GtkWidget *save_btn = gtk_button_new_with_label("Save Current Waybar Config");
-    g_signal_connect(save_btn, "clicked", G_CALLBACK(on_save_clicked), main_window);
-    gtk_box_append(GTK_BOX(vbox), save_btn);
+    GtkWidget *actions = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+    save_button = gtk_button_new_with_label("Save Current Waybar Config");
+    g_signal_connect(save_button, "clicked", G_CALLBACK(on_save_clicked), main_window);
+    restore_button = gtk_button_new_with_label("Restore Previous Config");
+    g_signal_connect(restore_button, "clicked", G_CALLBACK(on_restore_clicked), NULL);
+    gtk_box_append(GTK_BOX(actions), save_button);
+    gtk_box_append(GTK_BOX(actions), restore_button);
+    gtk_box_append(GTK_BOX(vbox), actions);
+
+    /* Progress of the running job, hidden while idle */
+    progress_row = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+    progress_bar = gtk_progress_bar_new();
+    gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(progress_bar), TRUE);
+    gtk_widget_set_hexpand(progress_bar, TRUE);
+    GtkWidget *cancel_btn = gtk_button_new_with_label("Cancel");
+    g_signal_connect(cancel_btn, "clicked", G_CALLBACK(on_cancel_job_clicked), NULL);
+    gtk_box_append(GTK_BOX(progress_row), progress_bar);
+    gtk_box_append(GTK_BOX(progress_row), cancel_btn);
+    gtk_widget_set_visible(progress_row, current_job != NULL);
+    gtk_box_append(GTK_BOX(vbox), progress_row);
 
     presets_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 6);
     gtk_box_append(GTK_BOX(vbox), presets_box);
 
+    /* A job may outlive the window; its completion must not touch dead widgets */
+    g_object_add_weak_pointer(G_OBJECT(presets_box), (gpointer *)&presets_box);
+    g_object_add_weak_pointer(G_OBJECT(save_button), (gpointer *)&save_button);
+    g_object_add_weak_pointer(G_OBJECT(restore_button), (gpointer *)&restore_button);
+    g_object_add_weak_pointer(G_OBJECT(progress_row), (gpointer *)&progress_row);
+    g_object_add_weak_pointer(G_OBJECT(progress_bar), (gpointer *)&progress_bar);
+
     refresh_presets_list();
 
     return scroll;
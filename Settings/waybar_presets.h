@@ -6,4 +6,8 @@
 /* Create the Waybar Presets tab, pass main window for dialogs */
 GtkWidget *create_waybar_presets_tab(GtkWindow *main_window);
 
+/* Re-list the presets (from the index, in the background); nothing
+ * before the tab exists */
+void waybar_presets_refresh(void);
+
 #endif // WAYBAR_PRESETS_H
@@ -0,0 +1,242 @@
+#include "waybar_reload.h"
+#include "stats.h"
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define DEFAULT_PROCESS_NAME "waybar"
+
+typedef struct {
+    pid_t pid;
+    guint64 start_time;  /* clock ticks after boot; tells a reused pid apart */
+} WaybarProcess;
+
+static char *g_script = NULL;         /* NULL: the default script */
+static char *g_process_name = NULL;   /* NULL: DEFAULT_PROCESS_NAME */
+static GArray *g_found = NULL;        /* WaybarProcess, from the last scan */
+
+void waybar_reload_set_script(const char *command_line) {
+    g_free(g_script);
+    g_script = g_strdup(command_line);
+}
+
+void waybar_reload_set_process_name(const char *name) {
+    g_free(g_process_name);
+    g_process_name = g_strdup(name);
+    if (g_found) g_array_set_size(g_found, 0);
+}
+
+/* ------------------------- finding waybar ------------------------ */
+/* Name and start time from /proc/<pid>/stat; FALSE once it is gone */
+static gboolean read_process(pid_t pid, char **comm, guint64 *start_time) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    gchar *stat = NULL;
+    if (!g_file_get_contents(path, &stat, NULL, NULL)) return FALSE;
+
+    /* "pid (comm) state ppid ...": comm may hold spaces and parentheses */
+    gboolean ok = FALSE;
+    char *open = strchr(stat, '(');
+    char *close = strrchr(stat, ')');
+    if (open && close && close > open && close[1] == ' ') {
+        /* fields from the state (3rd) on; the start time is the 22nd */
+        char **fields = g_strsplit(close + 2, " ", 21);
+        if (g_strv_length(fields) >= 20) {
+            *comm = g_strndup(open + 1, close - open - 1);
+            *start_time = g_ascii_strtoull(fields[19], NULL, 10);
+            ok = TRUE;
+        }
+        g_strfreev(fields);
+    }
+    g_free(stat);
+    return ok;
+}
+
+/* "waybar", or what Nix-style wrappers rename the real binary to,
+ * ".waybar-wrapped" */
+static gboolean name_matches(const char *candidate) {
+    const char *name = g_process_name ? g_process_name : DEFAULT_PROCESS_NAME;
+    if (strcmp(candidate, name) == 0) return TRUE;
+    gsize len = strlen(name);
+    return candidate[0] == '.' && strncmp(candidate + 1, name, len) == 0
+           && strcmp(candidate + 1 + len, "-wrapped") == 0;
+}
+
+/* The executable's name and argv[0]: comm is cut at 15 characters and a
+ * wrapped launch only keeps the real name in argv[0] */
+static gboolean names_match(pid_t pid) {
+    char path[64];
+    gboolean match = FALSE;
+
+    snprintf(path, sizeof(path), "/proc/%d/exe", (int)pid);
+    char *exe = g_file_read_link(path, NULL);
+    if (exe) {
+        if (g_str_has_suffix(exe, " (deleted)")) exe[strlen(exe) - strlen(" (deleted)")] = '\0';
+        char *base = g_path_get_basename(exe);
+        match = name_matches(base);
+        g_free(base);
+        g_free(exe);
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/cmdline", (int)pid);
+    gchar *cmdline = NULL;
+    gsize len = 0;
+    if (!match && g_file_get_contents(path, &cmdline, &len, NULL) && len > 0) {
+        /* argv[0] up to its NUL */
+        char *base = g_path_get_basename(cmdline);
+        match = name_matches(base);
+        g_free(base);
+    }
+    g_free(cmdline);
+    return match;
+}
+
+/* One of ours: the right name, and a process we may signal */
+static gboolean is_waybar(pid_t pid, guint64 *start_time) {
+    char path[64];
+    GStatBuf st;
+    snprintf(path, sizeof(path), "/proc/%d", (int)pid);
+    if (g_stat(path, &st) != 0 || st.st_uid != getuid()) return FALSE;
+
+    char *comm = NULL;
+    if (!read_process(pid, &comm, start_time)) return FALSE;
+    gboolean match = name_matches(comm) || names_match(pid);
+    g_free(comm);
+    return match;
+}
+
+static void scan_proc(GArray *found) {
+    g_array_set_size(found, 0);
+    GDir *dir = g_dir_open("/proc", 0, NULL);
+    if (!dir) return;
+
+    const char *name;
+    while ((name = g_dir_read_name(dir))) {
+        if (!g_ascii_isdigit(name[0])) continue;
+        WaybarProcess p = { (pid_t)atoi(name), 0 };
+        if (is_waybar(p.pid, &p.start_time)) g_array_append_val(found, p);
+    }
+    g_dir_close(dir);
+}
+
+/* The last scan's processes if they are all still there, else a new scan.
+ * Nothing found last time is always rescanned: Waybar may have started. */
+static GArray *find_waybar(void) {
+    if (!g_found) g_found = g_array_new(FALSE, FALSE, sizeof(WaybarProcess));
+
+    gboolean valid = g_found->len > 0;
+    for (guint i = 0; i < g_found->len && valid; i++) {
+        const WaybarProcess *p = &g_array_index(g_found, WaybarProcess, i);
+        guint64 start_time;
+        valid = is_waybar(p->pid, &start_time) && start_time == p->start_time;
+    }
+    if (!valid) scan_proc(g_found);
+    return g_found;
+}
+
+/* ------------------------- signalling ------------------------ */
+/* Through a pidfd where the kernel has them: once it is open and the
+ * process checked, the signal cannot reach a process that took over the
+ * pid in between */
+static gboolean signal_process(const WaybarProcess *p) {
+#if defined(SYS_pidfd_open) && defined(SYS_pidfd_send_signal)
+    int fd = (int)syscall(SYS_pidfd_open, p->pid, 0);
+    if (fd >= 0) {
+        guint64 start_time;
+        gboolean same = is_waybar(p->pid, &start_time) && start_time == p->start_time;
+        int rc = same ? (int)syscall(SYS_pidfd_send_signal, fd, SIGUSR2, NULL, 0) : -1;
+        close(fd);
+        return rc == 0;
+    }
+    if (errno != ENOSYS) return FALSE;
+#endif
+    return kill(p->pid, SIGUSR2) == 0;
+}
+
+/* ------------------------- script fallback ------------------------ */
+typedef struct {
+    WaybarReloadResult result;
+    gint64 start;  /* monotonic usec */
+    gint64 span;
+} ReloadJob;
+
+static void finish(GTask *task) {
+    ReloadJob *job = g_task_get_task_data(task);
+    job->result.usec = g_get_monotonic_time() - job->start;
+    stats_end(STATS_WAYBAR_RELOAD, job->span);
+}
+
+static void on_script_exit(GPid pid, gint status, gpointer user_data) {
+    GTask *task = user_data;
+    GError *error = NULL;
+    g_spawn_close_pid(pid);
+    finish(task);
+    if (g_spawn_check_wait_status(status, &error)) g_task_return_boolean(task, TRUE);
+    else g_task_return_error(task, error);
+    g_object_unref(task);
+}
+
+/* Quoted: the command line goes through g_shell_parse_argv() */
+static char *default_script(void) {
+    char *path = g_build_filename(g_get_home_dir(), "Dots", "Scripts", "Waybar", "waybar.sh", NULL);
+    char *quoted = g_shell_quote(path);
+    g_free(path);
+    return quoted;
+}
+
+/* Completes task when the script exits */
+static void run_script(GTask *task) {
+    char *command_line = g_script ? g_strdup(g_script) : default_script();
+    char **argv = NULL;
+    GPid pid;
+    GError *error = NULL;
+
+    if (*command_line == '\0') {
+        g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "Waybar is not running");
+    } else if (!g_shell_parse_argv(command_line, NULL, &argv, &error)
+               || !g_spawn_async(NULL, argv, NULL, G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD,
+                                 NULL, NULL, &pid, &error)) {
+        g_prefix_error(&error, "Waybar is not running, and %s failed: ", command_line);
+        g_task_return_error(task, error);
+    } else {
+        g_child_watch_add(pid, on_script_exit, g_object_ref(task));
+    }
+
+    g_strfreev(argv);
+    g_free(command_line);
+}
+
+/* ------------------------- reload ------------------------ */
+void waybar_reload_async(GAsyncReadyCallback callback, gpointer user_data) {
+    GTask *task = g_task_new(NULL, NULL, callback, user_data);
+    ReloadJob *job = g_new0(ReloadJob, 1);
+    job->start = g_get_monotonic_time();
+    job->span = stats_begin();
+    g_task_set_task_data(task, job, g_free);
+
+    GArray *found = find_waybar();
+    for (guint i = 0; i < found->len; i++)
+        job->result.processes += signal_process(&g_array_index(found, WaybarProcess, i));
+
+    if (job->result.processes > 0) {
+        job->result.method = WAYBAR_RELOAD_SIGNAL;
+        finish(task);
+        g_task_return_boolean(task, TRUE);
+    } else {
+        /* none, or all gone since the scan */
+        g_array_set_size(found, 0);
+        job->result.method = WAYBAR_RELOAD_SCRIPT;
+        run_script(task);
+    }
+    g_object_unref(task);
+}
+
+gboolean waybar_reload_finish(GAsyncResult *result, WaybarReloadResult *out, GError **error) {
+    if (!g_task_propagate_boolean(G_TASK(result), error)) return FALSE;
+    if (out) *out = ((ReloadJob *)g_task_get_task_data(G_TASK(result)))->result;
+    return TRUE;
+}
@@ -0,0 +1,39 @@
+#ifndef WAYBAR_RELOAD_H
+#define WAYBAR_RELOAD_H
+
+#include <gio/gio.h>
+
+/* Makes running Waybar instances re-read their config in place: SIGUSR2
+ * to every waybar process of this user, found by scanning /proc (by
+ * process name, executable or argv[0], so ".waybar-wrapped" launches
+ * count). The
+ * processes found are remembered and only rescanned for once one of them
+ * is gone. Only when there is none is the reload script run (by default
+ * ~/Dots/Scripts/Waybar/waybar.sh), which usually restarts the bar. */
+
+typedef enum {
+    WAYBAR_RELOAD_SIGNAL,  /* SIGUSR2 sent */
+    WAYBAR_RELOAD_SCRIPT,  /* the script ran and exited successfully */
+} WaybarReloadMethod;
+
+typedef struct {
+    WaybarReloadMethod method;
+    guint processes;  /* signalled, WAYBAR_RELOAD_SIGNAL */
+    gint64 usec;      /* from the request to the signals being delivered
+                       * or the script exiting. Waybar does not say when
+                       * it is done re-reading, so for signals this is
+                       * delivery, not the finished reload. */
+} WaybarReloadResult;
+
+/* The script run when no Waybar is running; NULL restores the default,
+ * "" runs nothing */
+void waybar_reload_set_script(const char *command_line);
+
+/* Name of the processes signalled, "waybar" by default. Exposed for
+ * testing against a dummy process that handles SIGUSR2. */
+void waybar_reload_set_process_name(const char *name);
+
+void waybar_reload_async(GAsyncReadyCallback callback, gpointer user_data);
+gboolean waybar_reload_finish(GAsyncResult *result, WaybarReloadResult *out, GError **error);
+
+#endif // WAYBAR_RELOAD_H